@@ -7,8 +7,10 @@ import SettingsForm from '@/components/SettingsForm';
 import ConveyorCalibrationButton from '@/components/buttons/ConveyorCalibrationButton';
 import DualVideo from '@/components/DualVideo';
 import ConveyorButton from '@/components/buttons/ConveyorButton';
+import ConveyorAutotuneButton from '@/components/buttons/ConveyorAutotuneButton';
 import MoveSorterButton from '@/components/buttons/MoverSorterButton';
 import HomeSorterButton from '@/components/buttons/HomeSorterButton';
+import OptimizeBinLayoutButton from '@/components/buttons/OptimizeBinLayoutButton';
 import JetButton from '@/components/buttons/JetButton';
 import JetCalibrationButton from '@/components/buttons/JetCalibrationButton';
 import { Button } from '@/components/ui/button';
@@ -43,7 +45,9 @@ const SettingsPage = () => {
             <MoveSorterButton />
             <JetButton />
             <HomeSorterButton />
+            <OptimizeBinLayoutButton />
             <ConveyorButton />
+            <ConveyorAutotuneButton />
             <JetCalibrationButton jetNumber={0} />
             <JetCalibrationButton jetNumber={1} />
             <JetCalibrationButton jetNumber={2} />
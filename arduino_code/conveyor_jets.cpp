@@ -1,7 +1,5 @@
-#include <PID_v1.h>
-
-#define CONVEYOR_DEBUG true
-#define SYSTEM_DEBUG true
+#include <util/atomic.h>
+#include "serial_link.h"
 
 #define JET_0_PIN 11
 #define JET_1_PIN 12
@@ -12,21 +10,138 @@
 #define ENCODER_PIN     2     // Encoder uses hardware interrupt 0 on pin 2
 
 #define MAX_MESSAGE_LENGTH 100 // buffer length for incoming serial communication
+#define JET_SCHEDULE_CAPACITY 16 // max number of pending timestamped jet fires
+#define JET_TRIGGER_CAPACITY 16 // max number of pending position-triggered jet fires
+
+// Jet pulse timer (Timer1, prescaler 8 at 16 MHz)
+#define JET_TIMER_TICKS_PER_US 2
+#define JET_TIMER_MIN_ARM_US 8      // time needed to write OCR1A before the compare point passes
+#define JET_TIMER_MAX_ARM_US 30000  // below the 32.7 ms Timer1 period
+#define JET_EDGE_TOLERANCE_US 4     // micros() resolution
+#define JET_MIN_PULSE_US 100
+#define JET_MAX_PULSE_US 2000000UL
 
 
-int JET_FIRE_TIMES[4];  // Array to store fire times for each jet
-bool jetActive[4] = {false, false, false, false};  // Track if each jet is currently firing
-unsigned long jetEndTime[4];  // Store end times for each jet
+int JET_FIRE_TIMES[4];  // Array to store fire times for each jet (ms, from settings)
+unsigned long jetPulseUs[4] = {0, 0, 0, 0};  // Pulse width of each jet in microseconds
+volatile bool jetActive[4] = {false, false, false, false};  // Track if each jet is currently firing
+volatile unsigned long jetOffAtUs[4];  // micros() at which each active jet closes
+volatile uint8_t *jetPortRegister[4];  // Direct port access for the jet pins
+uint8_t jetPinMask[4];
 bool settingsInitialized = false;
 
-// --- PID Speed Controller & Encoder Variables ---
+// --- Timestamped Jet Schedule ---
+// Jets can be queued ahead of time with a device micros() fire time ('J' command).
+// Entries are kept sorted by fire time so the timer ISR only ever has to look at the head.
+// Shared with the ISR, only touched with interrupts disabled.
+struct ScheduledJet {
+  unsigned long fireAtUs; // device micros() at which the jet should open
+  uint8_t jet;
+};
+ScheduledJet jetSchedule[JET_SCHEDULE_CAPACITY];
+volatile uint8_t jetScheduleCount = 0;
+
+// --- Position-Triggered Jets ---
+// Jets can also be queued for an encoder position ('K' command), so ejection follows where the
+// part physically is regardless of belt speed. Sorted by position and opened from the encoder ISR.
+struct PositionTrigger {
+  unsigned long position; // encoderPosition at which the jet should open
+  uint8_t jet;
+};
+PositionTrigger jetTriggers[JET_TRIGGER_CAPACITY];
+volatile uint8_t jetTriggerCount = 0;
+
+// --- Host Clock Sync ---
+unsigned long messageReceivedUs = 0; // micros() when the end marker of the current message arrived
+
+// --- Speed Controller & Encoder Variables ---
 int pulsesPerRevolution = 20; // Default pulses per revolution for the encoder wheel
-double Kp = 2.0, Ki = 5.0, Kd = 1.0;  // PID tuning parameters
-double Setpoint, Input, Output;        // PID variables
+double Kp = 2.0, Ki = 5.0, Kd = 1.0;  // PID tuning parameters (Ki per second, Kd in seconds)
+float rampedSetpoint = 0.0;  // setpoint the controller follows, moves toward targetRPM at rampRPMPerSecond
+float integralError = 0.0;   // integral term in PWM units, clamped and reset on stop
+float lastInputRPM = 0.0;    // previous measurement for the derivative term
+int pwmOutput = 0;           // last PWM value written to the motor
+int rampRPMPerSecond = 200;  // setpoint slew rate, 0 = step changes (from settings)
+#define INTEGRAL_LIMIT (CONV_MAX_PWM - CONV_MIN_PWM)
+
+// RPM -> PWM feedforward, FEEDFORWARD_POINTS values evenly spaced from 0 to maxConveyorRPM.
+// Defaults to a straight line over the PWM range until a calibrated table is loaded with 'F'.
+#define FEEDFORWARD_POINTS 6
+uint8_t feedforwardPwm[FEEDFORWARD_POINTS] = { 61, 77, 93, 108, 124, 140 };
+
+// Settling measurement: after every target change, the time until the speed stays within
+// SETTLE_BAND of the target for SETTLE_HOLD_WINDOWS control windows, reported as 'ST:'
+#define SETTLE_BAND_PERCENT 3
+#define SETTLE_BAND_MIN_RPM 2
+#define SETTLE_HOLD_WINDOWS 3
+#define SETTLE_TIMEOUT_MS 5000
+bool settlePending = false;
+unsigned long settleStartTime = 0;
+unsigned long settleInBandSince = 0;
+uint8_t settleWindowsInBand = 0;
+
+// --- Speed Controller Autotune ('A' command) ---
+// 1. Sweep: hold AUTOTUNE_SWEEP_STEPS open-loop PWM levels and average the settled RPM of each,
+//    which gives the static PWM -> RPM curve for the feedforward table.
+// 2. Relay (Astrom-Hagglund): around AUTOTUNE_SETPOINT_PERCENT of max RPM, switch the PWM between
+//    feedforward +/- AUTOTUNE_RELAY_PERCENT of the PWM range. The limit cycle's period and amplitude
+//    give the ultimate gain and period, turned into gains with the Tyreus-Luyben rules.
+#define AUTOTUNE_SWEEP_STEPS 8
+#define AUTOTUNE_SWEEP_HOLD_MS 2000     // time at each level, the last AUTOTUNE_MEASURE_MS are averaged
+#define AUTOTUNE_MEASURE_MS 600
+#define AUTOTUNE_SETPOINT_PERCENT 60
+#define AUTOTUNE_RELAY_PERCENT 10
+#define AUTOTUNE_RELAY_HYSTERESIS_RPM 0.5
+#define AUTOTUNE_RELAY_SKIP_CYCLES 2    // cycles left out while the oscillation builds up
+#define AUTOTUNE_RELAY_CYCLES 4         // cycles averaged
+#define AUTOTUNE_RELAY_TIMEOUT_MS 30000
+#define AUTOTUNE_MIN_AMPLITUDE_RPM 0.5
+
+enum AutotunePhase { AUTOTUNE_IDLE, AUTOTUNE_SWEEP, AUTOTUNE_RELAY };
+AutotunePhase autotunePhase = AUTOTUNE_IDLE;
+unsigned long autotuneStepStart = 0;
+uint8_t autotuneStep = 0;
+float autotuneRpmSum = 0.0;
+uint8_t autotuneRpmSamples = 0;
+uint8_t sweepPwm[AUTOTUNE_SWEEP_STEPS];
+float sweepRpm[AUTOTUNE_SWEEP_STEPS];
+float relaySetpoint = 0.0;
+int relayCenterPwm = 0;
+int relayAmplitudePwm = 0;
+bool relayHigh = false;
+uint8_t relayCycles = 0;
+unsigned long relayLastRiseTime = 0;
+unsigned long relayPeriodSumMs = 0;
+float relayAmplitudeSum = 0.0;
+float relayMaxRPM = 0.0;
+float relayMinRPM = 0.0;
 
-volatile long pulseCount = 0; // Incremented by encoder interrupt
 int currentRPM = 0;           // Calculated current RPM
 static float filteredRPM = 0.0; // Smoothed RPM value
+
+// --- Encoder Pulse Timestamps ---
+// Single-producer ring: the encoder ISR is the only writer of encoderHead and loop() the only
+// writer of encoderTail. Both indices are single bytes, so they are read and written atomically.
+#define ENCODER_RING_SIZE 16 // must be a power of two
+#define ENCODER_RING_MASK (ENCODER_RING_SIZE - 1)
+#define ENCODER_COUNT_FALLBACK_PULSES (ENCODER_RING_SIZE / 2) // more pulses per window: count instead
+#define ENCODER_STOP_TIMEOUT_US 500000UL // no pulse for this long means the belt is stopped
+
+volatile unsigned long encoderPulseUs[ENCODER_RING_SIZE];
+volatile uint8_t encoderHead = 0;
+uint8_t encoderTail = 0;
+unsigned long lastEncoderPulseUs = 0; // timestamp of the newest consumed pulse
+bool haveEncoderPulse = false;
+unsigned long encoderPeriodUs = 0;    // latest measured time per pulse, 0 = stopped
+
+// --- Conveyor Odometry ---
+// Total encoder pulses since boot, streamed to the host as 'O:<MICROS>,<POSITION>' samples
+#define ODOMETRY_MIN_INTERVAL_MS 10
+volatile unsigned long encoderPosition = 0;
+unsigned int odometryIntervalMs = 0; // 0 = streaming off
+unsigned long lastOdometrySampleTime = 0;
+unsigned long lastOdometryPosition = 0;
+
 unsigned long lastPwmAdjustmentTime = 0;
 #define PWM_ADJUSTMENT_INTERVAL 100 // Recalculate PWM every 100ms
 
@@ -40,59 +155,74 @@ const int CONV_MAX_PWM = 140;   // ~2.75 V
 const int CONV_MIN_PWM = 61;    // ~1.2 V minimum to start motor
 unsigned long lastDebugTime = 0;
 
-// Initialize PID controller
-PID myPID(&Input, &Output, &Setpoint, Kp, Ki, Kd, DIRECT);
-
 // --- Function Prototypes ---
 void countPulse();
+float measureConveyorRPM();
+void setOdometryInterval(unsigned int intervalMs);
+void serviceOdometryStream(unsigned long now);
 int getJetPin(int jetNumber);
+void fireJet(int jetNumber);
+bool scheduleJetFire(int jetNumber, unsigned long fireAtUs);
+bool cancelJetFire(int jetNumber, unsigned long fireAtUs);
+bool scheduleJetTrigger(int jetNumber, unsigned long position);
+bool cancelJetTrigger(int jetNumber, unsigned long position);
+void serviceJetTriggersLocked();
+void setTargetRPM(int rpm);
+void updateSpeedController(float dtSeconds);
+void resetSpeedController();
+void serviceSettling(unsigned long now);
+bool processFeedforwardMessage(char *message);
+void startAutotune();
+void stopAutotune(const char *reason);
+void updateAutotune(unsigned long now);
+void setupJetTimer();
+void resetJets();
 
 
 void setup()
 {
-  Serial.begin(9600);
+  Serial.begin(SERIAL_DEFAULT_BAUD);
 
   pinMode(JET_0_PIN, OUTPUT);
   pinMode(JET_1_PIN, OUTPUT);
   pinMode(JET_2_PIN, OUTPUT);
   pinMode(JET_3_PIN, OUTPUT);
+  setupJetTimer();
   
   pinMode(CONV_RPWM_PIN, OUTPUT);
   analogWrite(CONV_RPWM_PIN, 0);
 
-  // Initialize PID controller
-  myPID.SetMode(AUTOMATIC);
-  myPID.SetOutputLimits(CONV_MIN_PWM, CONV_MAX_PWM);
-  myPID.SetSampleTime(PWM_ADJUSTMENT_INTERVAL);
-
   // Setup for encoder interrupt on pin 2
   pinMode(ENCODER_PIN, INPUT_PULLUP);
   attachInterrupt(digitalPinToInterrupt(ENCODER_PIN), countPulse, RISING);
   // Auto-enable settings to allow on/off and speed commands without explicit settings
   settingsInitialized = true;
 
-  Serial.println("Ready");
-  Serial.println("Arduino setup complete. Motor speed should be 0.");
+  // Per-message and periodic debug output stays off unless requested with 'L'
+  setLogLevel(LOG_SYSTEM, LOG_LEVEL_INFO);
+  setLogLevel(LOG_CONVEYOR, LOG_LEVEL_INFO);
+
+  Link.println("Ready");
+  LOG_INFO(LOG_SYSTEM, "Arduino setup complete. Motor speed should be 0.");
 }
 
-void processSettings(char *message) {
+// Returns false if the message is malformed or does not carry all required settings
+bool processSettings(char *message) {
   // Validate message format
   if (message[0] != 's' || message[1] != ',') {
-    if (CONVEYOR_DEBUG) {
-      Serial.println("Error: Invalid settings message format");
-    }
-    return;
+    Link.println("Error: Invalid settings message format");
+    return false;
   }
   // Parse settings from message
-  // Expected format: 's,<FIRE_TIME_0>,<FIRE_TIME_1>,<FIRE_TIME_2>,<FIRE_TIME_3>,<MAX_RPM>,<MIN_RPM>,<PPR>,<KP_INT>,<KI_INT>,<KD_INT>'
+  // Expected format: 's,<FIRE_TIME_0>,<FIRE_TIME_1>,<FIRE_TIME_2>,<FIRE_TIME_3>,<MAX_RPM>,<MIN_RPM>,<PPR>,<KP_INT>,<KI_INT>,<KD_INT>,<RAMP_RPM_PER_S>'
   // Note: PPR = Pulses Per Revolution, Kp/Ki/Kd are sent as integers (e.g., float * 100)
   char *token;
-  int values[10]; // Array to hold 4 fire time, max/min RPM, PPR, Kp, Ki, Kd
+  int values[11]; // Array to hold 4 fire time, max/min RPM, PPR, Kp, Ki, Kd, ramp rate
   int valueIndex = 0;
 
   // Skip 's,' and start tokenizing
   token = strtok(&message[2], ",");
-  while (token != NULL && valueIndex < 10) {
+  while (token != NULL && valueIndex < 11) {
     values[valueIndex++] = atoi(token);
     token = strtok(NULL, ",");
   }
@@ -101,6 +231,7 @@ void processSettings(char *message) {
     // Store fire times
     for(int i = 0; i < 4; i++) {
       JET_FIRE_TIMES[i] = values[i];
+      jetPulseUs[i] = constrain((unsigned long)max(values[i], 0) * 1000UL, (unsigned long)JET_MIN_PULSE_US, JET_MAX_PULSE_US);
     }
     // Store RPM settings
     maxConveyorRPM = values[4];
@@ -111,111 +242,309 @@ void processSettings(char *message) {
     if (valueIndex >= 8) Kp = values[7] / 100.0; // Convert from int back to float
     if (valueIndex >= 9) Ki = values[8] / 100.0; // Convert from int back to float
     if (valueIndex >= 10) Kd = values[9] / 100.0; // Convert from int back to float
+    if (valueIndex >= 11) rampRPMPerSecond = max(values[10], 0);
 
 
-    Serial.println("--- SETTINGS RECEIVED ---");
-    Serial.print("Jet Fire Times: ");
-    for(int i=0; i<4; i++) { Serial.print(JET_FIRE_TIMES[i]); Serial.print(","); }
-    Serial.println("");
-    Serial.print("Max RPM: "); Serial.println(maxConveyorRPM);
-    Serial.print("Min RPM: "); Serial.println(minRPM);
-    Serial.print("PPR: "); Serial.println(pulsesPerRevolution);
-    Serial.print("Kp: "); Serial.println(Kp);
-    Serial.print("Ki: "); Serial.println(Ki);
-    Serial.print("Kd: "); Serial.println(Kd);
-    Serial.println("-------------------------");
+    LOG_INFO(LOG_CONVEYOR, "Jet Fire Times: %d,%d,%d,%d", JET_FIRE_TIMES[0], JET_FIRE_TIMES[1], JET_FIRE_TIMES[2],
+             JET_FIRE_TIMES[3]);
+    LOG_INFO(LOG_CONVEYOR, "Max RPM: %d, Min RPM: %d, PPR: %d", maxConveyorRPM, minRPM, pulsesPerRevolution);
+    LOG_INFO(LOG_CONVEYOR, "Kp/Ki/Kd x100: %d,%d,%d, ramp: %d RPM/s", (int)(Kp * 100), (int)(Ki * 100),
+             (int)(Kd * 100), rampRPMPerSecond);
 
     // Reset all state variables to their initial values
-    for(int i = 0; i < 4; i++) {
-      jetActive[i] = false;
-      jetEndTime[i] = 0;
-    }
+    resetJets(); // Close all jets and drop any pending scheduled jet fires
+    if (autotunePhase != AUTOTUNE_IDLE) stopAutotune("aborted");
     targetRPM = 0; // Reset speed to 0 for safety
-    Setpoint = 0; // Reset PID setpoint
-    myPID.SetTunings(Kp, Ki, Kd); // Update PID tunings
+    resetSpeedController();
+    settlePending = false;
 
     // Stop the conveyor motor
     analogWrite(CONV_RPWM_PIN, 0);
 
     settingsInitialized = true;
-    Serial.println("Settings updated");
-  } else {
-    Serial.println("Error: Not enough settings provided");
+    Link.println("Settings updated");
+    return true;
   }
+  Link.println("Error: Not enough settings provided");
+  return false;
 }
 
-void processMessage(char *message) {
-  // Debug: Print the received message
-  if (SYSTEM_DEBUG) {
-    Serial.print("SYSTEM: Processing message: '");
-    Serial.print(message);
-    Serial.print("', first char: '");
-    Serial.print(message[0]);
-    Serial.println("'");
+uint8_t processMessage(char *message) {
+  LOG_DEBUG(LOG_SYSTEM, "SYSTEM: Processing message: '%s'", message);
+
+  // Clock sync ping is answered even before settings so the host can sync right after 'Ready'
+  // Format: 't<SEQ>' -> 'T:<SEQ>,<MICROS>'
+  if (message[0] == 't') {
+    Link.print("T:");
+    Link.print(atol(message + 1));
+    Link.print(",");
+    Link.println(messageReceivedUs);
+    return FRAME_OK;
   }
-  
+
+  // Baud rate negotiation, format: 'U<BAUD>' then 'u' (see serial_link.h)
+  if (processBaudMessage(message)) {
+    return FRAME_OK;
+  }
+
+  // Log levels, format: 'L<SUBSYSTEM>,<LEVEL>' (see serial_log.h)
+  if (processLogMessage(message)) {
+    return FRAME_OK;
+  }
+
+  // Feedforward table, format: 'F<PWM_0>,...,<PWM_5>'
+  if (processFeedforwardMessage(message)) {
+    return FRAME_OK;
+  }
+
+  // Protocol switch, format: 'P1' -> binary frames (see serial_link.h)
+  if (message[0] == 'P') {
+    if (atoi(message + 1) == 1) {
+      Link.println("Binary mode");
+      binaryMode = true;
+    }
+    return FRAME_OK;
+  }
+
   // Add settings check at the start
   if (!settingsInitialized && message[0] != 's') {
-    Serial.println("Settings not initialized");
-    return;
+    Link.println("Settings not initialized");
+    return FRAME_NAK_BUSY;
   }
 
   int actionValue = atoi(message + 1); 
   switch (message[0]) {
 
     case 's': {
-      processSettings(message);
+      if (!processSettings(message)) {
+        return FRAME_NAK_INVALID;
+      }
       break;
     }
 
     case 'o': { // conveyor on off - toggles speed between 0 and max
-      if (targetRPM > 0) {
-        targetRPM = 0;
-      } else {
-        targetRPM = maxConveyorRPM;
-      }
-      Serial.print("'o' command received. New targetRPM: ");
-      Serial.println(targetRPM);
-      Setpoint = targetRPM; // Update PID setpoint
+      setTargetRPM(targetRPM > 0 ? 0 : maxConveyorRPM);
+      LOG_INFO(LOG_CONVEYOR, "'o' command received. New targetRPM: %d", targetRPM);
+      break;
+    }
+
+    case 'A': { // Format: 'A' or 'A1' starts the speed controller autotune, 'A0' aborts it
+      if (message[1] == '\0' || actionValue == 1) {
+        startAutotune();
+      } else if (autotunePhase != AUTOTUNE_IDLE) {
+        stopAutotune("aborted");
+      }
       break;
     }
 
     case 'c': { // Set target RPM 
-      targetRPM = constrain(actionValue, 0, maxConveyorRPM); // Constrain to safe range between 0 and maxConveyorRPM
-      Serial.print("'c' command received. New targetRPM: ");
-      Serial.println(targetRPM);
-      Setpoint = targetRPM; // Update PID setpoint
+      setTargetRPM(actionValue);
+      LOG_INFO(LOG_CONVEYOR, "'c' command received. New targetRPM: %d", targetRPM);
       break;
     }
     
     // jet fire
     case 'j': {  // action value is the jet number
-      Serial.print("Jet fire: ");
-      Serial.println(actionValue);
       if(actionValue >= 0 && actionValue < 4) {
-        int jetPin;
-        switch(actionValue) {
-          case 0: jetPin = JET_0_PIN; break;
-          case 1: jetPin = JET_1_PIN; break;
-          case 2: jetPin = JET_2_PIN; break;
-          case 3: jetPin = JET_3_PIN; break;
-        }
-        unsigned long jetStartTime = millis();
-        digitalWrite(jetPin, HIGH);
-        // Store the jet state and end time in global variables
-        jetActive[actionValue] = true;
-        jetEndTime[actionValue] = jetStartTime + JET_FIRE_TIMES[actionValue];
+        fireJet(actionValue);
+        LOG_DEBUG(LOG_CONVEYOR, "Jet fire: %d", actionValue);
       }
       else {
-        Serial.println("no matching jet number");
+        LOG_WARN(LOG_CONVEYOR, "no matching jet number");
+        return FRAME_NAK_INVALID;
       }
       break;
     }
 
-    default: {
-      Serial.println("no matching serial communication");
+    // timestamped jet fire
+    case 'J': {  // Format: 'J<JET>,<FIRE_AT_US>' where FIRE_AT_US is device micros()
+      char *comma = strchr(message, ',');
+      if (comma == NULL || actionValue < 0 || actionValue >= 4) {
+        Link.println("Error: Invalid scheduled jet message format");
+        return FRAME_NAK_INVALID;
+      }
+      unsigned long fireAtUs = strtoul(comma + 1, NULL, 10);
+      if (!scheduleJetFire(actionValue, fireAtUs)) {
+        Link.println("Error: Jet schedule full");
+        return FRAME_NAK_FULL;
+      }
+      break;
+    }
+
+    // position-triggered jet fire
+    case 'K': {  // Format: 'K<JET>,<POSITION>' where POSITION is the cumulative encoder position
+      char *comma = strchr(message, ',');
+      if (comma == NULL || actionValue < 0 || actionValue >= 4) {
+        Link.println("Error: Invalid jet trigger message format");
+        return FRAME_NAK_INVALID;
+      }
+      if (!scheduleJetTrigger(actionValue, strtoul(comma + 1, NULL, 10))) {
+        Link.println("Error: Jet trigger queue full");
+        return FRAME_NAK_FULL;
+      }
+      break;
+    }
+
+    // cancel position-triggered jet fire
+    case 'k': {  // Format: 'k<JET>,<POSITION>' - must match a previous 'K' exactly
+      char *comma = strchr(message, ',');
+      if (comma == NULL) {
+        Link.println("Error: Invalid jet trigger cancel message format");
+        return FRAME_NAK_INVALID;
+      }
+      if (!cancelJetTrigger(actionValue, strtoul(comma + 1, NULL, 10))) {
+        return FRAME_NAK_INVALID; // nothing matched, as for the binary 'k'
+      }
       break;
     }
+
+    // odometry stream
+    case 'e': {  // Format: 'e<INTERVAL_MS>', 0 turns the stream off
+      setOdometryInterval(max(actionValue, 0));
+      break;
+    }
+
+    // jet pulse width
+    case 'w': {  // Format: 'w<JET>,<PULSE_US>' - overrides the fire time from settings
+      char *comma = strchr(message, ',');
+      if (comma == NULL || actionValue < 0 || actionValue >= 4) {
+        Link.println("Error: Invalid jet pulse message format");
+        return FRAME_NAK_INVALID;
+      }
+      unsigned long pulseUs = constrain(strtoul(comma + 1, NULL, 10), (unsigned long)JET_MIN_PULSE_US, JET_MAX_PULSE_US);
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        jetPulseUs[actionValue] = pulseUs;
+      }
+      LOG_INFO(LOG_CONVEYOR, "Jet %d pulse: %lu us", actionValue, pulseUs);
+      break;
+    }
+
+    // cancel timestamped jet fire
+    case 'X': {  // Format: 'X<JET>,<FIRE_AT_US>' - must match a previous 'J' exactly
+      char *comma = strchr(message, ',');
+      if (comma == NULL) {
+        Link.println("Error: Invalid jet cancel message format");
+        return FRAME_NAK_INVALID;
+      }
+      if (!cancelJetFire(actionValue, strtoul(comma + 1, NULL, 10))) {
+        return FRAME_NAK_INVALID; // nothing matched, as for the binary 'X'
+      }
+      break;
+    }
+
+    default: {
+      LOG_WARN(LOG_SYSTEM, "no matching serial communication");
+      return FRAME_NAK_INVALID;
+    }
+  }
+  return FRAME_OK;
+}
+
+// --- Binary Frame Handling (see serial_link.h) ---
+void processFrame(uint8_t opcode, uint8_t seq, uint8_t *payload, uint8_t payloadLength) {
+  messageReceivedUs = micros();
+
+  // Commands accepted before settings
+  switch (opcode) {
+    case 't': { // clock sync ping, answered with a pong frame instead of an ACK
+      if (payloadLength != 4) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      uint8_t pong[8];
+      memcpy(pong, payload, 4);
+      frameWriteU32(&pong[4], messageReceivedUs);
+      sendFrame('T', 0, pong, sizeof(pong));
+      return;
+    }
+
+    case 'P': {
+      if (payloadLength != 1) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      sendAck(seq, opcode);
+      if (payload[0] == 0) {
+        binaryMode = false;
+        Link.println("ASCII mode");
+      }
+      return;
+    }
+  }
+
+  if (!settingsInitialized && opcode != 's') {
+    sendNak(seq, opcode, FRAME_NAK_BUSY);
+    return;
+  }
+
+  switch (opcode) {
+    case 'j': {
+      if (payloadLength != 1 || payload[0] >= 4) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      fireJet(payload[0]);
+      sendAck(seq, opcode);
+      return;
+    }
+
+    case 'J': {
+      if (payloadLength != 5 || payload[0] >= 4) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      if (!scheduleJetFire(payload[0], frameReadU32(&payload[1]))) {
+        sendNak(seq, opcode, FRAME_NAK_FULL);
+        return;
+      }
+      sendAck(seq, opcode);
+      return;
+    }
+
+    case 'X': {
+      if (payloadLength != 5 || !cancelJetFire(payload[0], frameReadU32(&payload[1]))) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      sendAck(seq, opcode);
+      return;
+    }
+
+    case 'K': {
+      if (payloadLength != 5 || payload[0] >= 4) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      if (!scheduleJetTrigger(payload[0], frameReadU32(&payload[1]))) {
+        sendNak(seq, opcode, FRAME_NAK_FULL);
+        return;
+      }
+      sendAck(seq, opcode);
+      return;
+    }
+
+    case 'k': {
+      if (payloadLength != 5 || !cancelJetTrigger(payload[0], frameReadU32(&payload[1]))) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      sendAck(seq, opcode);
+      return;
+    }
+
+    case 'c': {
+      if (payloadLength != 2) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      setTargetRPM(frameReadU16(payload));
+      sendAck(seq, opcode);
+      return;
+    }
+
+    default:
+      processTextFrame(opcode, seq, payload, payloadLength);
+      return;
   }
 }
 
@@ -228,14 +557,23 @@ void loop() {
   static bool capturingMessage = false;
   unsigned long now = millis();
 
+  // Fall back to the default baud rate if the host never confirmed a switch
+  serviceBaudNegotiation();
+
   while (Serial.available() > 0) {
     char inByte = Serial.read();
 
+    if (binaryMode) {
+      frameParserFeed((uint8_t)inByte);
+      continue;
+    }
+
     if(inByte == START_MARKER) {
       capturingMessage = true;
       message_pos = 0;
     }
     else if (inByte == END_MARKER) {
+      messageReceivedUs = micros();
       capturingMessage = false;
       message[message_pos] = '\0';  // Null terminate the string
       processMessage(message);
@@ -245,72 +583,638 @@ void loop() {
       message_pos++;
       if (message_pos >= MAX_MESSAGE_LENGTH) {
         capturingMessage = false;
-        Serial.println("Error: Message too long");
+        Link.println("Error: Message too long");
       }
     }
   }
 
-  // --- Closed-Loop PID Speed Control ---
+  // --- Closed-Loop Speed Control ---
   if (now - lastPwmAdjustmentTime >= PWM_ADJUSTMENT_INTERVAL) {
     lastPwmAdjustmentTime = now;
 
-    // 1. Calculate instantaneous RPM from encoder pulses
-    // Temporarily disable interrupts to safely read and reset pulseCount
-    noInterrupts();
-    long pulses = pulseCount;
-    pulseCount = 0;
-    interrupts();
-    
-    double intervalSeconds = (double)PWM_ADJUSTMENT_INTERVAL / 1000.0;
-    int rawRPM = (int)((double)pulses / (double)pulsesPerRevolution / intervalSeconds * 60.0);
+    // 1. Measure RPM from encoder pulse periods
+    float rawRPM = measureConveyorRPM();
     
-    // Apply exponential filter to smooth noisy readings
-    const float filterAlpha = 0.15; // Lower = more smoothing
-    if (filteredRPM == 0.0) {
-      filteredRPM = rawRPM; // Initialize on first reading
+    // Light smoothing only, period measurements are far less noisy than 100 ms pulse counts
+    const float filterAlpha = 0.5; // Lower = more smoothing
+    if (filteredRPM == 0.0 || rawRPM == 0.0) {
+      filteredRPM = rawRPM; // Initialize on first reading, and report a stop right away
     } else {
       filteredRPM = filterAlpha * rawRPM + (1.0 - filterAlpha) * filteredRPM;
     }
-    currentRPM = (int)filteredRPM;
+    currentRPM = (int)(filteredRPM + 0.5);
     
-    // 2. Update PID input with filtered RPM
-    Input = currentRPM;
-    
-    // 3. Let the PID controller compute the output
-    myPID.Compute();
-    
-    // 4. Apply the PID output to the motor
-    // The PID library already constrains Output to our set limits
-    if (targetRPM == 0) {
-      analogWrite(CONV_RPWM_PIN, 0); // Force stop when target is 0
+    // 2. Feedforward + PID on the ramped setpoint, written straight to the motor
+    if (autotunePhase != AUTOTUNE_IDLE) {
+      updateAutotune(now);
     } else {
-      analogWrite(CONV_RPWM_PIN, (int)Output);
+      updateSpeedController(PWM_ADJUSTMENT_INTERVAL / 1000.0);
     }
+
+    // 3. Report how long the last target change took to settle
+    serviceSettling(now);
   }
 
   // Periodically print debug info to avoid spamming serial
   if (now - lastDebugTime > 1000) {
     lastDebugTime = now;
-    Serial.print("[DEBUG] targetRPM: ");
-    Serial.print(targetRPM);
-    Serial.print(", currentRPM: ");
-    Serial.print(currentRPM);
-    Serial.print(", pwmValue: ");
-    Serial.println(Output); // Output is the constrained PWM value
+    // pwmOutput is the constrained PWM value
+    LOG_DEBUG(LOG_CONVEYOR, "[DEBUG] targetRPM: %d, setpoint: %d, currentRPM: %d, pwmValue: %d", targetRPM,
+              (int)rampedSetpoint, currentRPM, pwmOutput);
   }
 
-  // Check if any jets need to be turned off
-  for(int i = 0; i < 4; i++) {
-    if(jetActive[i] && now >= jetEndTime[i]) {
-      digitalWrite(getJetPin(i), LOW);
-      jetActive[i] = false;
-    }
-  }
+  serviceOdometryStream(now);
+
+  // Hand queued serial output to the hardware buffer without blocking
+  serialTxPump();
 }
 
 // --- Interrupt Service Routine for Encoder ---
 void countPulse() {
-  pulseCount++;
+  uint8_t head = encoderHead;
+  encoderPulseUs[head & ENCODER_RING_MASK] = micros();
+  encoderHead = head + 1;
+  encoderPosition++;
+  if (jetTriggerCount > 0) {
+    serviceJetTriggersLocked();
+  }
+}
+
+// Send one (device time, position) sample. While the belt moves the sample is the exact time of
+// the newest pulse, when it stands still the current time.
+void sendOdometrySample() {
+  unsigned long position;
+  unsigned long sampleUs;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    position = encoderPosition;
+    sampleUs = encoderPulseUs[(uint8_t)(encoderHead - 1) & ENCODER_RING_MASK];
+  }
+  if (position == lastOdometryPosition) {
+    sampleUs = micros();
+  }
+  lastOdometryPosition = position;
+
+  if (binaryMode) {
+    uint8_t payload[8];
+    frameWriteU32(payload, sampleUs);
+    frameWriteU32(&payload[4], position);
+    sendFrame('O', 0, payload, sizeof(payload));
+    return;
+  }
+  Link.print("O:");
+  Link.print(sampleUs);
+  Link.print(",");
+  Link.println(position);
+}
+
+void serviceOdometryStream(unsigned long now) {
+  if (odometryIntervalMs == 0 || now - lastOdometrySampleTime < odometryIntervalMs) return;
+  lastOdometrySampleTime = now;
+  sendOdometrySample();
+}
+
+void setOdometryInterval(unsigned int intervalMs) {
+  odometryIntervalMs = intervalMs == 0 ? 0 : max(intervalMs, (unsigned int)ODOMETRY_MIN_INTERVAL_MS);
+  LOG_INFO(LOG_CONVEYOR, "Odometry interval: %u ms", odometryIntervalMs);
+}
+
+// Conveyor speed from the time between encoder pulses. Averages the periods of all pulses
+// since the last call, so a single pulse per control window is enough for a full-resolution
+// reading. When pulses come faster than the ring comfortably holds, the number of pulses over
+// the time since the previous window's last pulse is used instead.
+float measureConveyorRPM() {
+  uint8_t head = encoderHead;
+  uint8_t pending = head - encoderTail;
+
+  if (pending >= ENCODER_COUNT_FALLBACK_PULSES) {
+    // Count-based: the newest timestamp is still valid, older ones may have been overwritten
+    unsigned long newestPulseUs;
+    noInterrupts();
+    newestPulseUs = encoderPulseUs[(uint8_t)(head - 1) & ENCODER_RING_MASK];
+    interrupts();
+    if (haveEncoderPulse) {
+      encoderPeriodUs = (newestPulseUs - lastEncoderPulseUs) / pending;
+    }
+    lastEncoderPulseUs = newestPulseUs;
+    haveEncoderPulse = true;
+    encoderTail = head;
+  } else {
+    // Period-based: slots between tail and head are not touched by the ISR until it laps the ring
+    unsigned long periodSumUs = 0;
+    uint8_t periods = 0;
+    while (encoderTail != head) {
+      unsigned long pulseUs = encoderPulseUs[encoderTail & ENCODER_RING_MASK];
+      if (haveEncoderPulse) {
+        periodSumUs += pulseUs - lastEncoderPulseUs;
+        periods++;
+      }
+      lastEncoderPulseUs = pulseUs;
+      haveEncoderPulse = true;
+      encoderTail++;
+    }
+    if (periods > 0) {
+      encoderPeriodUs = periodSumUs / periods;
+    }
+  }
+
+  unsigned long sinceLastPulseUs = micros() - lastEncoderPulseUs;
+  if (!haveEncoderPulse || encoderPeriodUs == 0 || sinceLastPulseUs > ENCODER_STOP_TIMEOUT_US) {
+    encoderPeriodUs = 0;
+    return 0.0;
+  }
+  // An overdue pulse means the belt is slowing down: the speed is at most one pulse per elapsed time
+  unsigned long periodUs = max(encoderPeriodUs, sinceLastPulseUs);
+  return 60000000.0 / ((float)periodUs * pulsesPerRevolution);
+}
+
+void setTargetRPM(int rpm) {
+  // Any speed command takes the motor back from a running autotune
+  if (autotunePhase != AUTOTUNE_IDLE) {
+    stopAutotune("aborted");
+  }
+  int previousTarget = targetRPM;
+  targetRPM = constrain(rpm, 0, maxConveyorRPM); // Constrain to safe range between 0 and maxConveyorRPM
+  if (targetRPM == previousTarget) return;
+
+  if (previousTarget == 0) {
+    // Starting: ramp up from wherever the belt is, with a fresh integrator
+    resetSpeedController();
+    rampedSetpoint = filteredRPM;
+  }
+  settlePending = true;
+  settleStartTime = millis();
+  settleWindowsInBand = 0;
+}
+
+// --- Speed Controller ---
+// PWM = feedforward(setpoint) + Kp * error + integral - Kd * d(measurement)/dt.
+// The feedforward carries the operating point, so the integrator only trims the remaining error;
+// it is clamped, frozen while the output saturates in the direction it would grow, and reset on stop.
+int feedforwardForRPM(float rpm) {
+  if (rpm <= 0 || maxConveyorRPM <= 0) return 0;
+  float position = rpm * (FEEDFORWARD_POINTS - 1) / maxConveyorRPM;
+  if (position >= FEEDFORWARD_POINTS - 1) return feedforwardPwm[FEEDFORWARD_POINTS - 1];
+  uint8_t index = (uint8_t)position;
+  float fraction = position - index;
+  return (int)(feedforwardPwm[index] + fraction * (feedforwardPwm[index + 1] - feedforwardPwm[index]) + 0.5);
+}
+
+void resetSpeedController() {
+  rampedSetpoint = 0.0;
+  integralError = 0.0;
+  lastInputRPM = filteredRPM;
+}
+
+void updateSpeedController(float dtSeconds) {
+  if (targetRPM == 0) {
+    // Stop right away and forget the integrator so the next start does not begin wound up
+    resetSpeedController();
+    pwmOutput = 0;
+    analogWrite(CONV_RPWM_PIN, 0);
+    return;
+  }
+
+  // Slew the setpoint toward the target
+  float step = rampRPMPerSecond > 0 ? rampRPMPerSecond * dtSeconds : (float)maxConveyorRPM;
+  if (rampedSetpoint < targetRPM) rampedSetpoint = min(rampedSetpoint + step, (float)targetRPM);
+  else if (rampedSetpoint > targetRPM) rampedSetpoint = max(rampedSetpoint - step, (float)targetRPM);
+
+  float error = rampedSetpoint - filteredRPM;
+  float derivative = (filteredRPM - lastInputRPM) / dtSeconds;
+  lastInputRPM = filteredRPM;
+
+  float base = feedforwardForRPM(rampedSetpoint) + Kp * error - Kd * derivative;
+  float candidateIntegral = constrain(integralError + Ki * error * dtSeconds, -INTEGRAL_LIMIT, INTEGRAL_LIMIT);
+  float output = base + candidateIntegral;
+
+  // Anti-windup: only accept integration that doesn't push further into saturation
+  bool saturatedHigh = output > CONV_MAX_PWM && error > 0;
+  bool saturatedLow = output < CONV_MIN_PWM && error < 0;
+  if (!saturatedHigh && !saturatedLow) {
+    integralError = candidateIntegral;
+  }
+
+  pwmOutput = constrain((int)(base + integralError + 0.5), CONV_MIN_PWM, CONV_MAX_PWM);
+  analogWrite(CONV_RPWM_PIN, pwmOutput);
+}
+
+// Report 'ST:<TARGET_RPM>,<SETTLE_MS>' once the speed holds within the band, -1 on timeout
+void serviceSettling(unsigned long now) {
+  if (!settlePending) return;
+
+  int band = max(targetRPM * SETTLE_BAND_PERCENT / 100, SETTLE_BAND_MIN_RPM);
+  if (abs(currentRPM - targetRPM) <= band) {
+    if (settleWindowsInBand == 0) settleInBandSince = now;
+    settleWindowsInBand++;
+  } else {
+    settleWindowsInBand = 0;
+  }
+
+  long settleMs;
+  if (settleWindowsInBand >= SETTLE_HOLD_WINDOWS) {
+    settleMs = settleInBandSince - settleStartTime;
+  } else if (now - settleStartTime >= SETTLE_TIMEOUT_MS) {
+    settleMs = -1;
+  } else {
+    return;
+  }
+  settlePending = false;
+  Link.print("ST:");
+  Link.print(targetRPM);
+  Link.print(",");
+  Link.println(settleMs);
+}
+
+// --- Speed Controller Autotune ---
+void setAutotunePwm(int pwm) {
+  pwmOutput = pwm;
+  analogWrite(CONV_RPWM_PIN, pwm);
+}
+
+void startAutotune() {
+  if (maxConveyorRPM <= 0) {
+    Link.println("AT:FAIL,no max RPM");
+    return;
+  }
+  targetRPM = 0;
+  settlePending = false;
+  resetSpeedController();
+  autotunePhase = AUTOTUNE_SWEEP;
+  autotuneStep = 0;
+  autotuneStepStart = millis();
+  autotuneRpmSum = 0.0;
+  autotuneRpmSamples = 0;
+  setAutotunePwm(CONV_MIN_PWM);
+  LOG_INFO(LOG_CONVEYOR, "Autotune: sweeping %d PWM levels", AUTOTUNE_SWEEP_STEPS);
+}
+
+// Leave the motor stopped, report a failure if a reason is given
+void stopAutotune(const char *reason) {
+  autotunePhase = AUTOTUNE_IDLE;
+  targetRPM = 0;
+  resetSpeedController();
+  setAutotunePwm(0);
+  if (reason != NULL) {
+    Link.print("AT:FAIL,");
+    Link.println(reason);
+  }
+}
+
+// Static curve -> feedforward table. The curve is forced monotonic so it can be inverted.
+void buildFeedforwardTable() {
+  for (uint8_t k = 1; k < AUTOTUNE_SWEEP_STEPS; k++) {
+    sweepRpm[k] = max(sweepRpm[k], sweepRpm[k - 1]);
+  }
+  feedforwardPwm[0] = CONV_MIN_PWM;
+  for (uint8_t i = 1; i < FEEDFORWARD_POINTS; i++) {
+    float rpm = (float)maxConveyorRPM * i / (FEEDFORWARD_POINTS - 1);
+    int pwm = CONV_MAX_PWM;
+    if (rpm <= sweepRpm[0]) {
+      pwm = sweepPwm[0];
+    } else {
+      for (uint8_t k = 1; k < AUTOTUNE_SWEEP_STEPS; k++) {
+        if (rpm <= sweepRpm[k]) {
+          float span = sweepRpm[k] - sweepRpm[k - 1];
+          float fraction = span > 0 ? (rpm - sweepRpm[k - 1]) / span : 1.0;
+          pwm = (int)(sweepPwm[k - 1] + fraction * (sweepPwm[k] - sweepPwm[k - 1]) + 0.5);
+          break;
+        }
+      }
+    }
+    feedforwardPwm[i] = (uint8_t)pwm;
+  }
+}
+
+void setRelayPwm() {
+  int pwm = relayHigh ? relayCenterPwm + relayAmplitudePwm : relayCenterPwm - relayAmplitudePwm;
+  setAutotunePwm(constrain(pwm, CONV_MIN_PWM, CONV_MAX_PWM));
+}
+
+void startRelayPhase(unsigned long now) {
+  // Oscillate around a speed the motor actually reaches
+  relaySetpoint = min((float)maxConveyorRPM * AUTOTUNE_SETPOINT_PERCENT / 100, sweepRpm[AUTOTUNE_SWEEP_STEPS - 1] * 0.8f);
+  relayCenterPwm = feedforwardForRPM(relaySetpoint);
+  relayAmplitudePwm = max((CONV_MAX_PWM - CONV_MIN_PWM) * AUTOTUNE_RELAY_PERCENT / 100, 1);
+  relayHigh = filteredRPM < relaySetpoint;
+  relayCycles = 0;
+  relayLastRiseTime = 0;
+  relayPeriodSumMs = 0;
+  relayAmplitudeSum = 0.0;
+  relayMaxRPM = filteredRPM;
+  relayMinRPM = filteredRPM;
+  autotunePhase = AUTOTUNE_RELAY;
+  autotuneStepStart = now;
+  LOG_INFO(LOG_CONVEYOR, "Autotune: relay at %d RPM, PWM %d +/- %d", (int)relaySetpoint, relayCenterPwm,
+           relayAmplitudePwm);
+}
+
+void finishAutotune(float periodSeconds, float amplitudeRPM) {
+  // Ultimate gain of the relay limit cycle, then Tyreus-Luyben PID rules
+  float ultimateGain = 4.0 * relayAmplitudePwm / (PI * amplitudeRPM);
+  Kp = ultimateGain / 2.2;
+  Ki = Kp / (2.2 * periodSeconds);
+  Kd = Kp * periodSeconds / 6.3;
+  stopAutotune(NULL);
+
+  Link.print("AT:");
+  Link.print((long)(Kp * 100 + 0.5));
+  Link.print(",");
+  Link.print((long)(Ki * 100 + 0.5));
+  Link.print(",");
+  Link.print((long)(Kd * 100 + 0.5));
+  for (uint8_t i = 0; i < FEEDFORWARD_POINTS; i++) {
+    Link.print(",");
+    Link.print(feedforwardPwm[i]);
+  }
+  Link.println();
+}
+
+// Runs once per control window instead of the speed controller
+void updateAutotune(unsigned long now) {
+  if (autotunePhase == AUTOTUNE_SWEEP) {
+    if (now - autotuneStepStart >= AUTOTUNE_SWEEP_HOLD_MS - AUTOTUNE_MEASURE_MS) {
+      autotuneRpmSum += filteredRPM;
+      autotuneRpmSamples++;
+    }
+    if (now - autotuneStepStart < AUTOTUNE_SWEEP_HOLD_MS) return;
+
+    sweepPwm[autotuneStep] = pwmOutput;
+    sweepRpm[autotuneStep] = autotuneRpmSamples > 0 ? autotuneRpmSum / autotuneRpmSamples : 0.0;
+    LOG_INFO(LOG_CONVEYOR, "Autotune: PWM %d -> %d RPM", pwmOutput, (int)sweepRpm[autotuneStep]);
+    autotuneStep++;
+    autotuneRpmSum = 0.0;
+    autotuneRpmSamples = 0;
+    autotuneStepStart = now;
+
+    if (autotuneStep < AUTOTUNE_SWEEP_STEPS) {
+      setAutotunePwm(CONV_MIN_PWM + (long)(CONV_MAX_PWM - CONV_MIN_PWM) * autotuneStep / (AUTOTUNE_SWEEP_STEPS - 1));
+      return;
+    }
+    if (sweepRpm[AUTOTUNE_SWEEP_STEPS - 1] < 1.0) {
+      stopAutotune("no encoder pulses");
+      return;
+    }
+    buildFeedforwardTable();
+    startRelayPhase(now);
+    setRelayPwm();
+    return;
+  }
+
+  // Relay phase
+  if (now - autotuneStepStart >= AUTOTUNE_RELAY_TIMEOUT_MS) {
+    stopAutotune("no stable oscillation");
+    return;
+  }
+  relayMaxRPM = max(relayMaxRPM, filteredRPM);
+  relayMinRPM = min(relayMinRPM, filteredRPM);
+
+  if (relayHigh && filteredRPM > relaySetpoint + AUTOTUNE_RELAY_HYSTERESIS_RPM) {
+    relayHigh = false;
+  } else if (!relayHigh && filteredRPM < relaySetpoint - AUTOTUNE_RELAY_HYSTERESIS_RPM) {
+    // A full cycle ends at every switch to high
+    relayHigh = true;
+    if (relayLastRiseTime != 0) {
+      relayCycles++;
+      if (relayCycles > AUTOTUNE_RELAY_SKIP_CYCLES) {
+        relayPeriodSumMs += now - relayLastRiseTime;
+        relayAmplitudeSum += (relayMaxRPM - relayMinRPM) / 2;
+      }
+    }
+    relayLastRiseTime = now;
+    relayMaxRPM = filteredRPM;
+    relayMinRPM = filteredRPM;
+
+    if (relayCycles >= AUTOTUNE_RELAY_SKIP_CYCLES + AUTOTUNE_RELAY_CYCLES) {
+      float amplitude = relayAmplitudeSum / AUTOTUNE_RELAY_CYCLES;
+      if (amplitude < AUTOTUNE_MIN_AMPLITUDE_RPM) {
+        stopAutotune("oscillation too small");
+        return;
+      }
+      finishAutotune(relayPeriodSumMs / 1000.0 / AUTOTUNE_RELAY_CYCLES, amplitude);
+      return;
+    }
+  }
+  setRelayPwm();
+}
+
+// Handles 'F<PWM_0>,...,<PWM_5>', PWM values for 0 to maxConveyorRPM in even steps.
+// Returns true if the message was consumed.
+bool processFeedforwardMessage(char *message) {
+  if (message[0] != 'F') return false;
+
+  uint8_t values[FEEDFORWARD_POINTS];
+  uint8_t count = 0;
+  char *token = strtok(message + 1, ",");
+  while (token != NULL && count < FEEDFORWARD_POINTS) {
+    values[count++] = (uint8_t)constrain(atoi(token), 0, 255);
+    token = strtok(NULL, ",");
+  }
+  if (count != FEEDFORWARD_POINTS || token != NULL) {
+    Link.println("Error: Invalid feedforward message format");
+    return true;
+  }
+  memcpy(feedforwardPwm, values, sizeof(feedforwardPwm));
+  Link.println("Feedforward updated");
+  return true;
+}
+
+// --- Jet Pulse Timer ---
+// Timer1 runs free at 2 MHz and its compare A interrupt produces every jet edge: openings from
+// the 'J' schedule and the closing edge of each pulse. Pins are written through their port
+// registers, so pulse widths no longer depend on how long loop() takes.
+void setupJetTimer() {
+  for (uint8_t i = 0; i < 4; i++) {
+    jetPortRegister[i] = portOutputRegister(digitalPinToPort(getJetPin(i)));
+    jetPinMask[i] = digitalPinToBitMask(getJetPin(i));
+  }
+  TCCR1A = 0;
+  TCCR1B = (1 << CS11); // normal mode, prescaler 8
+  TIMSK1 = 0;
+}
+
+// The helpers below touch state shared with the timer ISR and must run with interrupts disabled
+void openJetLocked(uint8_t jetNumber, unsigned long nowUs) {
+  *jetPortRegister[jetNumber] |= jetPinMask[jetNumber];
+  jetActive[jetNumber] = true;
+  jetOffAtUs[jetNumber] = nowUs + jetPulseUs[jetNumber];
+}
+
+void closeJetLocked(uint8_t jetNumber) {
+  *jetPortRegister[jetNumber] &= ~jetPinMask[jetNumber];
+  jetActive[jetNumber] = false;
+}
+
+// Program the compare interrupt for the earliest pending edge, or stop it if there is none.
+// Edges further out than the Timer1 period are reached by re-arming on the way.
+void armJetTimerLocked(unsigned long nowUs) {
+  bool pending = false;
+  long nextOffset = JET_TIMER_MAX_ARM_US;
+  for (uint8_t i = 0; i < 4; i++) {
+    if (jetActive[i]) {
+      pending = true;
+      nextOffset = min(nextOffset, (long)(jetOffAtUs[i] - nowUs));
+    }
+  }
+  if (jetScheduleCount > 0) {
+    pending = true;
+    nextOffset = min(nextOffset, (long)(jetSchedule[0].fireAtUs - nowUs));
+  }
+  if (!pending) {
+    TIMSK1 &= ~(1 << OCIE1A);
+    return;
+  }
+  nextOffset = max(nextOffset, (long)JET_TIMER_MIN_ARM_US);
+  OCR1A = TCNT1 + (uint16_t)(nextOffset * JET_TIMER_TICKS_PER_US);
+  TIFR1 = (1 << OCF1A); // drop a stale match from an earlier arm
+  TIMSK1 |= (1 << OCIE1A);
+}
+
+// Produce every edge that is due, then re-arm for the next one. Late openings fire right away.
+void serviceJetEdgesLocked() {
+  unsigned long nowUs = micros();
+  for (uint8_t i = 0; i < 4; i++) {
+    if (jetActive[i] && (long)(nowUs - jetOffAtUs[i]) >= -JET_EDGE_TOLERANCE_US) {
+      closeJetLocked(i);
+    }
+  }
+  while (jetScheduleCount > 0 && (long)(nowUs - jetSchedule[0].fireAtUs) >= -JET_EDGE_TOLERANCE_US) {
+    openJetLocked(jetSchedule[0].jet, nowUs);
+    jetScheduleCount--;
+    for (uint8_t i = 0; i < jetScheduleCount; i++) {
+      jetSchedule[i] = jetSchedule[i + 1];
+    }
+  }
+  armJetTimerLocked(nowUs);
+}
+
+ISR(TIMER1_COMPA_vect) {
+  serviceJetEdgesLocked();
+}
+
+// Open every jet whose trigger position has been reached. Runs in the encoder ISR, the closing
+// edge is then produced by the jet timer as for any other fire.
+void serviceJetTriggersLocked() {
+  unsigned long position = encoderPosition;
+  bool opened = false;
+  unsigned long nowUs = micros();
+  while (jetTriggerCount > 0 && (long)(position - jetTriggers[0].position) >= 0) {
+    openJetLocked(jetTriggers[0].jet, nowUs);
+    opened = true;
+    jetTriggerCount--;
+    for (uint8_t i = 0; i < jetTriggerCount; i++) {
+      jetTriggers[i] = jetTriggers[i + 1];
+    }
+  }
+  if (opened) {
+    armJetTimerLocked(nowUs);
+  }
+}
+
+// --- Jet Firing ---
+void fireJet(int jetNumber) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    unsigned long nowUs = micros();
+    openJetLocked(jetNumber, nowUs);
+    armJetTimerLocked(nowUs);
+  }
+}
+
+// Insert a jet fire into the schedule, keeping it sorted by fire time.
+// Comparisons are done relative to now so micros() rollover is handled.
+// Returns false if the schedule is full.
+bool scheduleJetFire(int jetNumber, unsigned long fireAtUs) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (jetScheduleCount >= JET_SCHEDULE_CAPACITY) {
+      return false;
+    }
+    unsigned long nowUs = micros();
+    long fireOffset = (long)(fireAtUs - nowUs);
+
+    uint8_t insertIndex = jetScheduleCount;
+    while (insertIndex > 0 && (long)(jetSchedule[insertIndex - 1].fireAtUs - nowUs) > fireOffset) {
+      jetSchedule[insertIndex] = jetSchedule[insertIndex - 1];
+      insertIndex--;
+    }
+    jetSchedule[insertIndex].fireAtUs = fireAtUs;
+    jetSchedule[insertIndex].jet = jetNumber;
+    jetScheduleCount++;
+    armJetTimerLocked(nowUs);
+  }
+  return true;
+}
+
+// Remove a scheduled jet fire. Returns false if no matching entry was pending.
+bool cancelJetFire(int jetNumber, unsigned long fireAtUs) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    for (uint8_t i = 0; i < jetScheduleCount; i++) {
+      if (jetSchedule[i].jet == jetNumber && jetSchedule[i].fireAtUs == fireAtUs) {
+        jetScheduleCount--;
+        for (uint8_t j = i; j < jetScheduleCount; j++) {
+          jetSchedule[j] = jetSchedule[j + 1];
+        }
+        armJetTimerLocked(micros());
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Insert a position trigger, keeping the queue sorted by position. Positions are compared
+// relative to the current position so counter rollover is handled. A position that has already
+// been passed fires right away. Returns false if the queue is full.
+bool scheduleJetTrigger(int jetNumber, unsigned long position) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (jetTriggerCount >= JET_TRIGGER_CAPACITY) {
+      return false;
+    }
+    unsigned long current = encoderPosition;
+    long offset = (long)(position - current);
+    if (offset <= 0) {
+      unsigned long nowUs = micros();
+      openJetLocked(jetNumber, nowUs);
+      armJetTimerLocked(nowUs);
+      return true;
+    }
+
+    uint8_t insertIndex = jetTriggerCount;
+    while (insertIndex > 0 && (long)(jetTriggers[insertIndex - 1].position - current) > offset) {
+      jetTriggers[insertIndex] = jetTriggers[insertIndex - 1];
+      insertIndex--;
+    }
+    jetTriggers[insertIndex].position = position;
+    jetTriggers[insertIndex].jet = jetNumber;
+    jetTriggerCount++;
+  }
+  return true;
+}
+
+// Remove a position trigger. Returns false if no matching entry was pending.
+bool cancelJetTrigger(int jetNumber, unsigned long position) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    for (uint8_t i = 0; i < jetTriggerCount; i++) {
+      if (jetTriggers[i].jet == jetNumber && jetTriggers[i].position == position) {
+        jetTriggerCount--;
+        for (uint8_t j = i; j < jetTriggerCount; j++) {
+          jetTriggers[j] = jetTriggers[j + 1];
+        }
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Close every jet and drop all pending scheduled and position-triggered fires
+void resetJets() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    for (uint8_t i = 0; i < 4; i++) {
+      closeJetLocked(i);
+    }
+    jetScheduleCount = 0;
+    jetTriggerCount = 0;
+    armJetTimerLocked(micros());
+  }
 }
 
 int getJetPin(int jetNumber) {
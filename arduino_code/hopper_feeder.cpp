@@ -2,13 +2,11 @@
 #include <Wire.h>
 #include "FastAccelStepper.h"
 #include <limits.h>
+#include "serial_link.h"
 // Watchdog Timer removed: We now handle errors in software and do not reset the Arduino automatically.
 
 #define AUTO_DISABLE true
 
-#define FEEDER_DEBUG false
-#define HOPPER_DEBUG false
-#define SYSTEM_DEBUG false
 
 #define ENABLE_PIN 6
 #define DIR_PIN 5
@@ -27,27 +25,79 @@
 // Hopper Variables
 int hopperFullStrokeSteps = 2020; // motor steps it takes to move from top to bottom
 unsigned long lastHopperActionTime = 0;  // will store the last time the task was run
-const long hopperBottomWaitTime = 10;  // interval at which to run the task (milliseconds)
+long hopperBottomWaitTime = 10;  // interval at which to run the task (milliseconds)
+
+// Hopper stroke profile, set at runtime with 'M'
+int hopperLoadedStrokeSteps = 0;                 // stroke while a part waits at the feeder exit, 0 = full stroke
+unsigned long hopperDownSpeedUs = SPEED;         // us/step
+unsigned long hopperUpSpeedUs = SPEED;
+unsigned long hopperDownAcceleration = ACCELERATION; // steps/s^2
+unsigned long hopperUpAcceleration = ACCELERATION;
+long hopperTopPosition = 0;   // where the current cycle returns to
+bool hopperFullStroke = true; // the current cycle goes all the way to the bottom switch
 bool settingsInitialized = false;
 
+// Hopper cycle policy, decides when a new cycle starts
+enum class HopperPolicy : uint8_t {
+  vibration_time, // the feeder vibrated for HOPPER_CYCLE_INTERVAL ms
+  starvation,     // no part was at the exit sensor for hopperPolicyThreshold ms
+  fill_level,     // the fill sensor reads farther than hopperPolicyThreshold, the hopper runs low
+};
+#define HOPPER_TRIGGER_MANUAL 3 // cycle started with 'o1'
+HopperPolicy hopperPolicy = HopperPolicy::vibration_time;
+long hopperPolicyThreshold = 0;
+unsigned long hopperMinCycleInterval = 0; // ms from the end of a cycle before starvation or fill level start another
+
+// Per-cycle statistics, reported when the next cycle starts
+unsigned long hopperCycleStartTime = 0;   // 0 = no cycle yet
+unsigned long hopperCycleEndTime = 0;
+unsigned long lastPartSeenTime = 0;       // last time a part arrived at or left the exit sensor
+unsigned int partsSinceHopperCycle = 0;
+
 FastAccelStepperEngine engine = FastAccelStepperEngine();
 FastAccelStepper *hopperStepper = NULL;
  
 // --- Depth Sensor Variables
-unsigned short distanceReading = 0;
-unsigned char i2cReceiveBuffer[16];
-unsigned char distanceSensorAddress = 80;
+// The distance sensors share the I2C bus. A read is a register write, a conversion delay and a 2 byte
+// read. Only the write and the read use the bus, so sensors convert in parallel while the scheduler
+// starts at most one bus transfer per loop. Sensors whose reading is stable are polled less often.
+#define MAX_DISTANCE_SENSORS 2
+#define SENSOR_FEEDER 0                // feeder exit, drives the part detection
+#define SENSOR_FILL 1                  // hopper fill level, optional
+#define SENSOR_CONVERSION_US 30000UL   // ToF sensors need ~20-50 ms for a reading
+#define SENSOR_CHANGE_DISTANCE 3       // a reading this far from the last one restores the fastest cadence
+#define SENSOR_MIN_BACKOFF_MS 10
+#define I2C_TIMEOUT_US 25000           // Wire transfers give up instead of hanging on a stuck bus
+#define I2C_RECOVERY_MS 10             // the bus is released this long before it is reinitialized
 
 enum class SensorReadState : uint8_t {
   IDLE,
-  REQUEST_SENT,
-  WAITING_FOR_READING
+  REQUEST_SENT
 };
-SensorReadState currentSensorState = SensorReadState::IDLE;
-unsigned long sensorRequestTime = 0;
-const unsigned long SENSOR_READ_DELAY_US = 30000; // Increased from 30us. 30us is too short for most ToF sensors, which need ~20-50ms for a reading. This prevents spamming the bus.
-unsigned long sensorWaitStartTime = 0; // for timeout
-const unsigned long SENSOR_READ_TIMEOUT_MS = 10;
+
+struct DistanceSensor {
+  unsigned char address;         // 0 = not fitted
+  unsigned int minIntervalMs;    // time between reads while the reading changes
+  unsigned int maxIntervalMs;    // time between reads once it is stable
+  unsigned int intervalMs;       // current time between reads
+  SensorReadState state;
+  unsigned long lastReadMillis;  // when the last read finished
+  unsigned long requestMicros;   // when the conversion was requested
+  unsigned short reading;
+  bool readingValid;             // false if the last read failed
+  unsigned long reads;           // health counters
+  unsigned long failures;
+  uint8_t consecutiveFailures;
+};
+
+DistanceSensor distanceSensors[MAX_DISTANCE_SENSORS] = {
+  { 80, 0, 200, 0, SensorReadState::IDLE, 0, 0, 0, false, 0, 0, 0 },
+  { 0, 200, 2000, 200, SensorReadState::IDLE, 0, 0, 0, false, 0, 0, 0 },
+};
+uint8_t nextSensor = 0; // round robin start for the next bus transfer
+bool i2cRecovering = false;
+unsigned long i2cRecoveryStartMillis = 0;
+unsigned long i2cRecoveries = 0;
 
 // -- Feeder Variables
 #define FEEDER_RPWM_PIN 11    // Changed from FEEDER_ENABLE_PIN
@@ -68,18 +118,45 @@ int FEEDER_PAUSE_TIME = 100;       // Time to pause between feeder movements
 int FEEDER_SHORT_MOVE_TIME = 1000;   // Duration of short feeder movement
 int FEEDER_LONG_MOVE_TIME = 1000;   // Maximum time to run feeder before stopping
 
+// Part rate control: with a target rate set, the feeder speed and pause are tuned from the time
+// between part detections instead of using FEEDER_VIBRATION_SPEED and FEEDER_PAUSE_TIME
+#define RATE_MIN_PAUSE_TIME 10       // ms
+#define RATE_SPEED_STEP 4            // speed change per part when the pause alone cannot hold the rate
+#define RATE_MAX_INTERVAL 60000UL    // ms, longer gaps (empty hopper, stopped feeder) are not measured
+int FEEDER_TARGET_RATE = 0;             // parts per minute, 0 = fixed speed and pause
+int rateVibrationSpeed = 0;             // feeder speed chosen by the rate controller
+long ratePauseTime = 0;                 // pause chosen by the rate controller
+unsigned long smoothedPartInterval = 0; // ms between parts, exponentially smoothed, 0 = no measurement yet
+unsigned long lastPartTime = 0;         // when the last part reached the sensor, 0 = none yet
+
+// Part detection: distance readings are median filtered, then compared against separate arrive and
+// leave thresholds so a part at the edge of the beam does not toggle the detection
+#define PART_ARRIVE_DISTANCE 20     // filtered distance below which a part has arrived
+#define PART_LEAVE_DISTANCE 26      // filtered distance above which the part has left
+#define PART_DEBOUNCE_READINGS 2    // consecutive filtered readings past a threshold to change state
+#define PART_MEDIAN_WINDOW 3
+#define SENSOR_MAX_FAILED_READS 3   // consecutive failed reads after which no part is assumed
+unsigned short distanceWindow[PART_MEDIAN_WINDOW];
+uint8_t distanceWindowCount = 0;    // valid readings in the window
+uint8_t distanceWindowNext = 0;
+uint8_t partDebounceCount = 0;
+unsigned long partEdgeMicros = 0;   // first reading past the threshold of the pending state change
+uint8_t failedSensorReads = 0;
+bool partPresent = false;
+unsigned long partArrivedMicros = 0;
+
 // Debug variables
 unsigned long lastDebugTime = 0;     // For controlling debug print frequency
 unsigned long lastHeartbeatTime = 0; // For main loop heartbeat
 unsigned long lastReadySendTime = 0; // For periodic "Ready" signal
+unsigned long messageReceivedUs = 0; // micros() when the end marker of the current message arrived
 
 // Function declarations
-int ReadDistance(unsigned char device);
-bool getLatestDistanceReading(unsigned short &reading); // New function to get reading when available
+int serviceDistanceSensors();
 
 void setup() {
   // The very first thing we do is initialize the serial port so we can always send debug messages.
-  Serial.begin(9600,SERIAL_8N1);
+  Serial.begin(SERIAL_DEFAULT_BAUD, SERIAL_8N1);
   // A small delay to allow the serial port to stabilize and for the server to
   // connect before we start sending data. This helps prevent garbled initial messages.
   delay(500);
@@ -87,6 +164,7 @@ void setup() {
   // Watchdog logic removed. If a subsystem fails, we will log and attempt recovery in software.
 
   Wire.begin(); 
+  Wire.setWireTimeout(I2C_TIMEOUT_US, true);
 
   // Watchdog timer removed. We rely on robust non-blocking code and error recovery.
 
@@ -115,12 +193,134 @@ void setup() {
     hopperStepper->move(100);
   }
   // Always send Ready signal so server can send settings
-  Serial.println("Ready"); 
+  Link.println("Ready");
+}
+
+int feederSpeed() {
+  return FEEDER_TARGET_RATE > 0 ? rateVibrationSpeed : FEEDER_VIBRATION_SPEED;
+}
+
+long feederPauseTime() {
+  return FEEDER_TARGET_RATE > 0 ? ratePauseTime : FEEDER_PAUSE_TIME;
+}
+
+// Start the rate controller from the fixed settings and forget the measured rate
+void resetPartRate() {
+  rateVibrationSpeed = FEEDER_VIBRATION_SPEED;
+  ratePauseTime = max(FEEDER_PAUSE_TIME, RATE_MIN_PAUSE_TIME);
+  smoothedPartInterval = 0;
+  lastPartTime = 0;
+}
+
+// Called when a part reaches the sensor. The pause after each part is what spaces parts out, so it
+// is adjusted first; only when it is at its limit does the feeder shake harder or softer.
+void updatePartRate(unsigned long now) {
+  unsigned long interval = now - lastPartTime;
+  bool measured = lastPartTime != 0 && interval <= RATE_MAX_INTERVAL;
+  lastPartTime = now;
+  if (FEEDER_TARGET_RATE <= 0 || !measured) {
+    return;
+  }
+
+  smoothedPartInterval = smoothedPartInterval == 0 ? interval : (smoothedPartInterval * 3 + interval) / 4;
+  long targetInterval = 60000L / FEEDER_TARGET_RATE;
+  long error = targetInterval - (long)smoothedPartInterval; // > 0: parts come too fast
+
+  long maxPauseTime = max(targetInterval, (long)RATE_MIN_PAUSE_TIME);
+  ratePauseTime = constrain(ratePauseTime + error / 4, (long)RATE_MIN_PAUSE_TIME, maxPauseTime);
+  if (error < 0 && ratePauseTime == RATE_MIN_PAUSE_TIME) {
+    rateVibrationSpeed = min(rateVibrationSpeed + RATE_SPEED_STEP, MAX_FEEDER_SPEED);
+  } else if (error > 0 && ratePauseTime == maxPauseTime) {
+    rateVibrationSpeed = max(rateVibrationSpeed - RATE_SPEED_STEP, RAMP_START_SPEED);
+  }
+
+  LOG_INFO(LOG_FEEDER, "RATE: %lu parts/min, speed %d, pause %ld ms", 60000UL / max(smoothedPartInterval, 1UL),
+           rateVibrationSpeed, ratePauseTime);
+}
+
+unsigned short medianDistance() {
+  unsigned short sorted[PART_MEDIAN_WINDOW];
+  for (uint8_t i = 0; i < distanceWindowCount; i++) {
+    unsigned short value = distanceWindow[i];
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > value; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = value;
+  }
+  return sorted[distanceWindowCount / 2];
+}
+
+// Part edge events, timestamped with the first reading that crossed the threshold:
+// 'PA:<MICROS>' when a part arrives, 'PL:<MICROS>,<DWELL_MS>' when it leaves
+void setPartPresent(bool present, unsigned long edgeMicros) {
+  partPresent = present;
+  lastPartSeenTime = millis();
+  if (present) {
+    partArrivedMicros = edgeMicros;
+    partsSinceHopperCycle++;
+    Link.print("PA:");
+    Link.println(edgeMicros);
+    updatePartRate(millis());
+  } else {
+    Link.print("PL:");
+    Link.print(edgeMicros);
+    Link.print(",");
+    Link.println((edgeMicros - partArrivedMicros) / 1000);
+  }
+}
+
+// Forget the filtered readings and assume no part, so the feeder keeps moving
+void resetPartDetection(unsigned long now) {
+  distanceWindowCount = 0;
+  distanceWindowNext = 0;
+  partDebounceCount = 0;
+  if (partPresent) {
+    setPartPresent(false, now);
+  }
+}
+
+// Feed one sensor read result into the part detection, valid = false for a failed read
+void updatePartDetection(bool valid, unsigned short distance) {
+  unsigned long now = micros();
+
+  if (!valid) {
+    if (failedSensorReads < SENSOR_MAX_FAILED_READS) {
+      failedSensorReads++;
+    }
+    if (failedSensorReads < SENSOR_MAX_FAILED_READS) {
+      return; // a single failed read keeps the current state
+    }
+    // The sensor is gone: assume no part so the feeder keeps moving, and start over once it is back
+    resetPartDetection(now);
+    return;
+  }
+  failedSensorReads = 0;
+
+  distanceWindow[distanceWindowNext] = distance;
+  distanceWindowNext = (distanceWindowNext + 1) % PART_MEDIAN_WINDOW;
+  if (distanceWindowCount < PART_MEDIAN_WINDOW) {
+    distanceWindowCount++;
+  }
+
+  unsigned short filtered = medianDistance();
+  bool crossed = partPresent ? filtered > PART_LEAVE_DISTANCE : filtered < PART_ARRIVE_DISTANCE;
+  if (!crossed) {
+    partDebounceCount = 0;
+    return;
+  }
+  if (partDebounceCount == 0) {
+    partEdgeMicros = now;
+  }
+  if (++partDebounceCount >= PART_DEBOUNCE_READINGS) {
+    partDebounceCount = 0;
+    setPartPresent(!partPresent, partEdgeMicros);
+  }
 }
 
 void startMotor() {
   digitalWrite(FEEDER_R_EN_PIN, HIGH);
-  analogWrite(FEEDER_RPWM_PIN, FEEDER_VIBRATION_SPEED);
+  analogWrite(FEEDER_RPWM_PIN, feederSpeed());
 }
 
 void stopMotor() {
@@ -141,20 +341,18 @@ FeederState currFeederState = FeederState::start_moving;
 void checkFeeder() {
   unsigned long currentMillis = millis();
 
-  // Add sensor reading debug
-  int distance = ReadDistance(distanceSensorAddress);
-  bool partDetected = distance < 20;
-  if (FEEDER_DEBUG && partDetected) {
-    Serial.println("SENSOR: Part detected in front of sensor");
+  bool partDetected = partPresent; // filtered, see updatePartDetection()
+
+  // Poll the exit sensor as fast as it converts while a part can arrive or leave
+  if (currFeederState != FeederState::paused || partDetected) {
+    distanceSensors[SENSOR_FEEDER].intervalMs = distanceSensors[SENSOR_FEEDER].minIntervalMs;
   }
 
   switch (currFeederState) {
     case FeederState::start_moving: {
       // This state now initiates the ramp-up for a long move.
       feederVibrationStartTime = currentMillis;
-      if (FEEDER_DEBUG) {
-        Serial.println("FeederSTATE: -> ramp_up_move");
-      }
+      LOG_DEBUG(LOG_FEEDER, "FeederSTATE: -> ramp_up_move");
       currFeederState = FeederState::ramp_up_move;
       // Motor is started within ramp_up_move state
       break;
@@ -166,9 +364,7 @@ void checkFeeder() {
       if (partDetected) {
         stopMotor();
         totalFeederVibrationTime += elapsedTime;
-        if (FEEDER_DEBUG) {
-          Serial.println("FeederSTATE: -> paused (from ramp_up_move, part detected)");
-        }
+        LOG_DEBUG(LOG_FEEDER, "FeederSTATE: -> paused (from ramp_up_move, part detected)");
         currFeederState = FeederState::paused;
         lastFeederActionTime = currentMillis;
         break; // Exit immediately
@@ -177,9 +373,7 @@ void checkFeeder() {
       if (elapsedTime >= FEEDER_LONG_MOVE_TIME) { // Also check for total timeout during ramp
         stopMotor();
         totalFeederVibrationTime += elapsedTime;
-        if (FEEDER_DEBUG) {
-          Serial.println("FeederSTATE: -> paused (from ramp_up_move, timeout)");
-        }
+        LOG_DEBUG(LOG_FEEDER, "FeederSTATE: -> paused (from ramp_up_move, timeout)");
         currFeederState = FeederState::paused;
         lastFeederActionTime = currentMillis;
         break;
@@ -187,7 +381,7 @@ void checkFeeder() {
       
       if (elapsedTime < RAMP_UP_DURATION) {
         // Still ramping up
-        int currentSpeed = map(elapsedTime, 0, RAMP_UP_DURATION, RAMP_START_SPEED, FEEDER_VIBRATION_SPEED);
+        int currentSpeed = map(elapsedTime, 0, RAMP_UP_DURATION, RAMP_START_SPEED, feederSpeed());
         // Explicitly clamp the speed to the absolute maximum allowed value.
         // This provides an extra layer of safety.
         currentSpeed = constrain(currentSpeed, 0, MAX_FEEDER_SPEED);
@@ -196,10 +390,8 @@ void checkFeeder() {
       } else {
         // Ramp-up finished, transition to full-speed moving.
         // Set the motor to its final target speed to ensure a smooth transition.
-        analogWrite(FEEDER_RPWM_PIN, FEEDER_VIBRATION_SPEED);
-        if (FEEDER_DEBUG) {
-          Serial.println("FeederSTATE: -> moving (from ramp_up_move)");
-        }
+        analogWrite(FEEDER_RPWM_PIN, feederSpeed());
+        LOG_DEBUG(LOG_FEEDER, "FeederSTATE: -> moving (from ramp_up_move)");
         currFeederState = FeederState::moving;
       }
       break;
@@ -215,9 +407,7 @@ void checkFeeder() {
         //  update total vibration time
         totalFeederVibrationTime += elapsedTime;
         stopMotor();
-        if (FEEDER_DEBUG) {
-          Serial.println("FeederSTATE: -> paused (from moving)");
-        }
+        LOG_DEBUG(LOG_FEEDER, "FeederSTATE: -> paused (from moving)");
         currFeederState = FeederState::paused;
         lastFeederActionTime = currentMillis;
       }
@@ -225,20 +415,16 @@ void checkFeeder() {
     }
     
     case FeederState::paused: {
-      if (currentMillis - lastFeederActionTime >= FEEDER_PAUSE_TIME) {
+      if (currentMillis - lastFeederActionTime >= (unsigned long)feederPauseTime()) {
         
         if (partDetected) { 
           startMotor(); 
           feederVibrationStartTime = currentMillis;
-          if (FEEDER_DEBUG) {
-            Serial.println("FeederSTATE: -> short_move (from paused)");
-          }
+          LOG_DEBUG(LOG_FEEDER, "FeederSTATE: -> short_move (from paused)");
           currFeederState = FeederState::short_move;
           lastFeederActionTime = currentMillis;
         } else {
-          if (FEEDER_DEBUG) {
-            Serial.println("FeederSTATE: -> start_moving (from paused)");
-          }
+          LOG_DEBUG(LOG_FEEDER, "FeederSTATE: -> start_moving (from paused)");
           currFeederState = FeederState::start_moving;
         }
       }
@@ -250,9 +436,7 @@ void checkFeeder() {
         stopMotor();
         // Correctly account for the vibration time of the short move
         totalFeederVibrationTime += (currentMillis - lastFeederActionTime);
-        if (FEEDER_DEBUG) {
-          Serial.println("FeederSTATE: -> paused (from short_move)");
-        }
+        LOG_DEBUG(LOG_FEEDER, "FeederSTATE: -> paused (from short_move)");
         currFeederState = FeederState::paused;
         lastFeederActionTime = currentMillis;
       }
@@ -271,108 +455,301 @@ enum class HopperState : uint8_t {
 
 static HopperState currHopperState = HopperState::waiting_top;
 
+// Returns the policy that asks for a new cycle, or -1
+int hopperCycleTrigger(unsigned long now) {
+  const DistanceSensor &fill = distanceSensors[SENSOR_FILL];
+  HopperPolicy policy = hopperPolicy;
+  // Without a fill reading the vibration time is the best guess
+  if (policy == HopperPolicy::fill_level && (fill.address == 0 || !fill.readingValid)) {
+    policy = HopperPolicy::vibration_time;
+  }
+
+  if (policy == HopperPolicy::vibration_time) {
+    return totalFeederVibrationTime >= (unsigned long)HOPPER_CYCLE_INTERVAL ? (int)policy : -1;
+  }
+  // Parts released by the last cycle need a while to reach the sensors
+  if (now - hopperCycleEndTime < hopperMinCycleInterval) {
+    return -1;
+  }
+  if (policy == HopperPolicy::starvation) {
+    // A part waiting at the exit is supply, however long it has been there
+    if (partPresent) {
+      return -1;
+    }
+    unsigned long lastSupply = max(lastPartSeenTime, hopperCycleEndTime);
+    return now - lastSupply >= (unsigned long)hopperPolicyThreshold ? (int)policy : -1;
+  }
+  return (long)fill.reading > hopperPolicyThreshold ? (int)policy : -1;
+}
+
+// Stroke of the next automatic cycle: release fewer parts while the feeder is still loaded
+int hopperCycleStroke() {
+  return partPresent && hopperLoadedStrokeSteps > 0 ? hopperLoadedStrokeSteps : hopperFullStrokeSteps;
+}
+
+// Report the statistics of the cycle that just ended and start a new one:
+// 'HC:<TRIGGER>,<MS_SINCE_LAST_CYCLE>,<PARTS>,<VIBRATION_MS>,<FILL>,<STROKE>', FILL -1 without a fill reading
+void startHopperCycle(int trigger, unsigned long now, int strokeSteps) {
+  strokeSteps = constrain(strokeSteps, 1, hopperFullStrokeSteps);
+  const DistanceSensor &fill = distanceSensors[SENSOR_FILL];
+  Link.print("HC:");
+  Link.print(trigger);
+  Link.print(",");
+  Link.print(hopperCycleStartTime == 0 ? 0UL : now - hopperCycleStartTime);
+  Link.print(",");
+  Link.print(partsSinceHopperCycle);
+  Link.print(",");
+  Link.print(totalFeederVibrationTime);
+  Link.print(",");
+  Link.print(fill.address != 0 && fill.readingValid ? (long)fill.reading : -1L);
+  Link.print(",");
+  Link.println(strokeSteps);
+
+  LOG_DEBUG(LOG_HOPPER, "HOPPER: Starting new cycle - moving down. Trigger: %d, stroke: %d", trigger, strokeSteps);
+  hopperCycleStartTime = now;
+  partsSinceHopperCycle = 0;
+  totalFeederVibrationTime = 0;
+  hopperTopPosition = hopperStepper->getCurrentPosition();
+  hopperFullStroke = strokeSteps >= hopperFullStrokeSteps;
+  hopperStepper->setSpeedInUs(hopperDownSpeedUs);
+  hopperStepper->setAcceleration(hopperDownAcceleration);
+  // A full stroke overshoots a little to be sure to reach the bottom switch
+  hopperStepper->move(hopperFullStroke ? -hopperFullStrokeSteps-20 : -strokeSteps);
+  LOG_DEBUG(LOG_HOPPER, "HopperSTATE: -> moving_down");
+  currHopperState = HopperState::moving_down;
+}
+
 void checkHopper()
 {
   unsigned long currentMillis = millis();
 
   switch (currHopperState)
   {
-    case HopperState::waiting_top: 
-    if (HOPPER_DEBUG) {
-      if (currentMillis - lastDebugTime >= 5000) {  // Print every 5 seconds
-        Serial.print("HOPPER: Current vibration time: ");
-        Serial.print(totalFeederVibrationTime);
-        Serial.print(" / ");
-        Serial.print(HOPPER_CYCLE_INTERVAL);
-        Serial.print(" (");
-        Serial.print((totalFeederVibrationTime * 100) / HOPPER_CYCLE_INTERVAL);
-        Serial.println("%)");
-        lastDebugTime = currentMillis;
-      }
+    case HopperState::waiting_top: {
+    if (currentMillis - lastDebugTime >= 5000) {  // Print every 5 seconds
+      LOG_DEBUG(LOG_HOPPER, "HOPPER: Current vibration time: %lu / %lu (%lu%%)", (unsigned long)totalFeederVibrationTime,
+                (unsigned long)HOPPER_CYCLE_INTERVAL,
+                (unsigned long)((totalFeederVibrationTime * 100) / HOPPER_CYCLE_INTERVAL));
+      lastDebugTime = currentMillis;
+    }
+    int trigger = hopperCycleTrigger(currentMillis);
+    if (trigger >= 0) {
+      startHopperCycle(trigger, currentMillis, hopperCycleStroke());
     }
-    if (totalFeederVibrationTime >= HOPPER_CYCLE_INTERVAL) {
-      if (HOPPER_DEBUG) {
-        Serial.print("HOPPER: Starting new cycle - moving down. Total vibration time: ");
-        Serial.println(totalFeederVibrationTime);
-      }
-      totalFeederVibrationTime = 0;
-      hopperStepper->move(-hopperFullStrokeSteps-20);
-      if (HOPPER_DEBUG) {
-        Serial.println("HopperSTATE: -> moving_down");
-      }
-      currHopperState = HopperState::moving_down;
-    } 
     break;
+    }
 
-    case HopperState::moving_down: 
-      if (digitalRead(STOP_PIN) == LOW || !hopperStepper->isRunning()) {
-        hopperStepper->forceStopAndNewPosition(0);
-        lastHopperActionTime = currentMillis;      
-        if (HOPPER_DEBUG) {
-          Serial.println("HopperSTATE: -> waiting_bottom");
+    case HopperState::moving_down: {
+      bool atBottom = digitalRead(STOP_PIN) == LOW;
+      if (atBottom || !hopperStepper->isRunning()) {
+        if (atBottom || hopperFullStroke) {
+          // The bottom is the reference, the top a full stroke above it
+          hopperStepper->forceStopAndNewPosition(0);
+          hopperTopPosition = hopperFullStrokeSteps;
         }
+        lastHopperActionTime = currentMillis;      
+        LOG_DEBUG(LOG_HOPPER, "HopperSTATE: -> waiting_bottom");
         currHopperState = HopperState::waiting_bottom;
       }
       break;
+    }
 
     case HopperState::waiting_bottom:
       if (currentMillis - lastHopperActionTime >= hopperBottomWaitTime) {
-        hopperStepper->move(hopperFullStrokeSteps);
-        if (HOPPER_DEBUG) {
-          Serial.println("HopperSTATE: -> moving_up");
-        }
+        hopperStepper->setSpeedInUs(hopperUpSpeedUs);
+        hopperStepper->setAcceleration(hopperUpAcceleration);
+        hopperStepper->moveTo(hopperTopPosition);
+        LOG_DEBUG(LOG_HOPPER, "HopperSTATE: -> moving_up");
         currHopperState = HopperState::moving_up;
       } 
       break;
 
     case HopperState::moving_up:
       if (!hopperStepper->isRunning()) {
-        if (HOPPER_DEBUG) {
-          Serial.println("HopperSTATE: -> waiting_top");
-        }
+        hopperCycleEndTime = currentMillis;
+        LOG_DEBUG(LOG_HOPPER, "HopperSTATE: -> waiting_top");
         currHopperState = HopperState::waiting_top;
       } 
       break;
   }
 }
 
-void processMessage(char *message) {
+uint8_t processMessage(char *message) {
+  // Clock sync ping is answered even before settings so the host can sync right after 'Ready'
+  // Format: 't<SEQ>' -> 'T:<SEQ>,<MICROS>'
+  if (message[0] == 't') {
+    Link.print("T:");
+    Link.print(atol(message + 1));
+    Link.print(",");
+    Link.println(messageReceivedUs);
+    return FRAME_OK;
+  }
+
+  // Baud rate negotiation, format: 'U<BAUD>' then 'u' (see serial_link.h)
+  if (processBaudMessage(message)) {
+    return FRAME_OK;
+  }
+
+  // Log levels, format: 'L<SUBSYSTEM>,<LEVEL>' (see serial_log.h)
+  if (processLogMessage(message)) {
+    return FRAME_OK;
+  }
+
+  // Protocol switch, format: 'P1' -> binary frames (see serial_link.h)
+  if (message[0] == 'P') {
+    if (atoi(message + 1) == 1) {
+      Link.println("Binary mode");
+      binaryMode = true;
+    }
+    return FRAME_OK;
+  }
+
   // Add settings check at the start
   if (!settingsInitialized && message[0] != 's') {
-    if (SYSTEM_DEBUG) {
-      Serial.println("Settings not initialized");
-    }
-    return;
+    LOG_DEBUG(LOG_SYSTEM, "Settings not initialized");
+    return FRAME_NAK_BUSY;
   }
 
   switch (message[0]) {
     case 's': {
-      processSettings(message);
+      if (!processSettings(message)) {
+        return FRAME_NAK_INVALID;
+      }
       break;
     }
 
     case 'p': { // pause time update
       // Format: 'p,<new_pause_time>'
       if (message[1] != ',') {
-        if (FEEDER_DEBUG) {
-          Serial.println("Error: Invalid pause time message format");
-        }
-        return;
+        LOG_DEBUG(LOG_FEEDER, "Error: Invalid pause time message format");
+        return FRAME_NAK_INVALID;
       }
       
       char *token = strtok(&message[2], ",");
       if (!token) {
-        if (FEEDER_DEBUG) {
-          Serial.println("Error: Missing pause time value");
-        }
-        return;
+        LOG_DEBUG(LOG_FEEDER, "Error: Missing pause time value");
+        return FRAME_NAK_INVALID;
       }
       
       FEEDER_PAUSE_TIME = atoi(token);
       
-      if (FEEDER_DEBUG) {
-        Serial.print("Pause time updated to: ");
-        Serial.println(FEEDER_PAUSE_TIME);
+      LOG_DEBUG(LOG_FEEDER, "Pause time updated to: %d", FEEDER_PAUSE_TIME);
+      break;
+    }
+
+    case 'R': { // target part rate
+      // Format: 'R<PARTS_PER_MIN>', 0 = back to the fixed speed and pause time
+      int rate = max(atoi(message + 1), 0);
+      if (FEEDER_TARGET_RATE == 0 && rate > 0) {
+        resetPartRate();
+      }
+      FEEDER_TARGET_RATE = rate;
+      LOG_DEBUG(LOG_FEEDER, "Target rate updated to: %d parts/min", FEEDER_TARGET_RATE);
+      break;
+    }
+
+    case 'C': { // hopper cycle policy
+      // Format: 'C<POLICY>,<THRESHOLD>,<MIN_CYCLE_INTERVAL_MS>', see HopperPolicy
+      char *token = strtok(&message[1], ",");
+      int policy = token ? atoi(token) : -1;
+      char *threshold = strtok(NULL, ",");
+      char *minInterval = strtok(NULL, ",");
+      if (policy < 0 || policy > (int)HopperPolicy::fill_level || !threshold || !minInterval) {
+        LOG_DEBUG(LOG_HOPPER, "Error: Invalid hopper policy message format");
+        return FRAME_NAK_INVALID;
+      }
+      hopperPolicy = (HopperPolicy)policy;
+      hopperPolicyThreshold = max(atol(threshold), 0L);
+      hopperMinCycleInterval = max(atol(minInterval), 0L);
+      LOG_DEBUG(LOG_HOPPER, "Hopper policy %d, threshold %ld, min interval %lu ms", policy, hopperPolicyThreshold,
+                hopperMinCycleInterval);
+      break;
+    }
+
+    case 'M': { // hopper stroke profile
+      // Format: 'M<STROKE_STEPS>,<DOWN_SPEED_US>,<DOWN_ACCELERATION>,<UP_SPEED_US>,<UP_ACCELERATION>,<DWELL_MS>[,<LOADED_STROKE_STEPS>]'
+      // Speeds are in us/step, accelerations in steps/s^2. Applies from the next move.
+      long values[7];
+      int valueIndex = 0;
+      char *token = strtok(&message[1], ",");
+      while (token != NULL && valueIndex < 7) {
+        values[valueIndex++] = atol(token);
+        token = strtok(NULL, ",");
+      }
+      if (valueIndex < 6 || values[0] <= 0 || values[1] <= 0 || values[2] <= 0 || values[3] <= 0 || values[4] <= 0) {
+        LOG_DEBUG(LOG_HOPPER, "Error: Invalid hopper profile message format");
+        return FRAME_NAK_INVALID;
+      }
+      hopperFullStrokeSteps = values[0];
+      hopperDownSpeedUs = values[1];
+      hopperDownAcceleration = values[2];
+      hopperUpSpeedUs = values[3];
+      hopperUpAcceleration = values[4];
+      hopperBottomWaitTime = max(values[5], 0L);
+      hopperLoadedStrokeSteps = valueIndex > 6 ? constrain(values[6], 0L, values[0]) : 0;
+      LOG_DEBUG(LOG_HOPPER, "Hopper stroke %d (%d while loaded), down %lu us, up %lu us, dwell %ld ms",
+                hopperFullStrokeSteps, hopperLoadedStrokeSteps, hopperDownSpeedUs, hopperUpSpeedUs,
+                hopperBottomWaitTime);
+      break;
+    }
+
+    case 'S': { // distance sensor setup
+      // Format: 'S<INDEX>,<ADDRESS>[,<MIN_INTERVAL_MS>,<MAX_INTERVAL_MS>]', address 0 = not fitted
+      char *token = strtok(&message[1], ",");
+      int index = token ? atoi(token) : -1;
+      token = strtok(NULL, ",");
+      if (index < 0 || index >= MAX_DISTANCE_SENSORS || !token) {
+        LOG_DEBUG(LOG_FEEDER, "Error: Invalid sensor setup message format");
+        return FRAME_NAK_INVALID;
+      }
+      DistanceSensor &sensor = distanceSensors[index];
+      unsigned char address = constrain(atoi(token), 0, 127);
+      token = strtok(NULL, ",");
+      if (token) {
+        sensor.minIntervalMs = max(atoi(token), 0);
+        token = strtok(NULL, ",");
+        sensor.maxIntervalMs = token ? max(atoi(token), (int)sensor.minIntervalMs) : sensor.minIntervalMs;
+      }
+      if (address != sensor.address) {
+        sensor.address = address;
+        sensor.state = SensorReadState::IDLE;
+        sensor.readingValid = false;
+        sensor.reads = 0;
+        sensor.failures = 0;
+        sensor.consecutiveFailures = 0;
+        if (index == SENSOR_FEEDER) {
+          // Readings of the old sensor, or none at all once it is removed, must not hold the feeder
+          resetPartDetection(micros());
+        }
+      }
+      sensor.intervalMs = sensor.minIntervalMs;
+      LOG_DEBUG(LOG_FEEDER, "Sensor %d: address %d, every %u-%u ms", index, address, sensor.minIntervalMs,
+                sensor.maxIntervalMs);
+      break;
+    }
+
+    case 'H': { // distance sensor health
+      // One 'SH:<INDEX>,<ADDRESS>,<READS>,<FAILURES>,<INTERVAL_MS>,<READING>,<BUS_RECOVERIES>' line per
+      // fitted sensor, READING -1 if the last read failed
+      for (uint8_t i = 0; i < MAX_DISTANCE_SENSORS; i++) {
+        const DistanceSensor &sensor = distanceSensors[i];
+        if (sensor.address == 0) {
+          continue;
+        }
+        Link.print("SH:");
+        Link.print(i);
+        Link.print(",");
+        Link.print(sensor.address);
+        Link.print(",");
+        Link.print(sensor.reads);
+        Link.print(",");
+        Link.print(sensor.failures);
+        Link.print(",");
+        Link.print(sensor.intervalMs);
+        Link.print(",");
+        Link.print(sensor.readingValid ? (long)sensor.reading : -1L);
+        Link.print(",");
+        Link.println(i2cRecoveries);
       }
       break;
     }
@@ -380,42 +757,86 @@ void processMessage(char *message) {
     case 'o': { // hopper on/off
       if (message[1] == '1') {
         // Start hopper cycle
-        if (HOPPER_DEBUG) {
-          Serial.println("HOPPER: Starting new cycle - moving down");
-        }
-        hopperStepper->move(-hopperFullStrokeSteps-20);
-        currHopperState = HopperState::moving_down;
+        // Format: 'o1[,<STROKE_STEPS>]', a full stroke by default
+        int strokeSteps = message[2] == ',' ? atoi(message + 3) : hopperFullStrokeSteps;
+        startHopperCycle(HOPPER_TRIGGER_MANUAL, millis(), strokeSteps);
       } else {
         // Stop hopper
         hopperStepper->forceStop();
         currHopperState = HopperState::waiting_top;
       }
-      if (HOPPER_DEBUG) {
-        Serial.println(message[1] == '1' ? "hopper on" : "hopper off");
-      }
+      LOG_DEBUG(LOG_HOPPER, "%s", message[1] == '1' ? "hopper on" : "hopper off");
       break;
     }
 
     default: {
-      if (SYSTEM_DEBUG) {
-        Serial.println("no matching serial communication");
+      LOG_DEBUG(LOG_SYSTEM, "no matching serial communication");
+      return FRAME_NAK_INVALID;
+    }
+  }
+  return FRAME_OK;
+}
+
+// --- Binary Frame Handling (see serial_link.h) ---
+void processFrame(uint8_t opcode, uint8_t seq, uint8_t *payload, uint8_t payloadLength) {
+  messageReceivedUs = micros();
+
+  switch (opcode) {
+    case 't': { // clock sync ping, answered with a pong frame instead of an ACK
+      if (payloadLength != 4) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
       }
-      break;
+      uint8_t pong[8];
+      memcpy(pong, payload, 4);
+      frameWriteU32(&pong[4], messageReceivedUs);
+      sendFrame('T', 0, pong, sizeof(pong));
+      return;
+    }
+
+    case 'P': {
+      if (payloadLength != 1) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      sendAck(seq, opcode);
+      if (payload[0] == 0) {
+        binaryMode = false;
+        Link.println("ASCII mode");
+      }
+      return;
+    }
+
+    case 'p': { // pause time update
+      if (payloadLength != 2) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      if (!settingsInitialized) {
+        sendNak(seq, opcode, FRAME_NAK_BUSY);
+        return;
+      }
+      FEEDER_PAUSE_TIME = frameReadU16(payload);
+      sendAck(seq, opcode);
+      return;
     }
+
+    default:
+      processTextFrame(opcode, seq, payload, payloadLength);
+      return;
   }
 }
 
-void processSettings(char *message) {
+// Returns false if the message is malformed or does not carry all required settings
+bool processSettings(char *message) {
   // Parse settings from message
   // Expected format: 's,<HOPPER_CYCLE_INTERVAL>,<FEEDER_VIBRATION_SPEED>,<FEEDER_STOP_DELAY>,<FEEDER_PAUSE_TIME>,<FEEDER_SHORT_MOVE_TIME>,<FEEDER_LONG_MOVE_TIME>'
   // Note: The 's' character is the command identifier, followed by 6 comma-separated settings values
   
   // Validate message format
   if (message[0] != 's' || message[1] != ',') {
-    if (SYSTEM_DEBUG) {
-      Serial.println("Error: Invalid message format");
-    }
-    return;
+    LOG_DEBUG(LOG_SYSTEM, "Error: Invalid message format");
+    return false;
   }
 
   char *token;
@@ -455,14 +876,17 @@ void processSettings(char *message) {
     feederVibrationStartTime = 0;
     lastHopperActionTime = 0;
     lastDebugTime = 0;
+    resetPartRate();
+    hopperCycleStartTime = 0;
+    hopperCycleEndTime = millis();
+    partsSinceHopperCycle = 0;
 
     settingsInitialized = true;
-    Serial.println("Settings updated");
-  } else {
-    if (SYSTEM_DEBUG) {
-      Serial.println("Error: Not enough settings provided");
-    }
+    Link.println("Settings updated");
+    return true;
   }
+  LOG_DEBUG(LOG_SYSTEM, "Error: Not enough settings provided");
+  return false;
 }
 
 #define START_MARKER '<'
@@ -477,34 +901,37 @@ void loop() {
 
   // Heartbeat for main loop
   if (currentLoopMillis - lastHeartbeatTime >= 5000) {
-    if (SYSTEM_DEBUG) {
-      Serial.println("HEARTBEAT: Main loop is alive.");
-    }
+    LOG_DEBUG(LOG_SYSTEM, "HEARTBEAT: Main loop is alive.");
     lastHeartbeatTime = currentLoopMillis;
   }
 
-  // Process sensor reading periodically
-  processSensorReading(distanceSensorAddress);
+  // Poll the distance sensors, every finished read of the exit sensor updates the part detection
+  if (serviceDistanceSensors() == SENSOR_FEEDER) {
+    updatePartDetection(distanceSensors[SENSOR_FEEDER].readingValid, distanceSensors[SENSOR_FEEDER].reading);
+  }
+
+  // Fall back to the default baud rate if the host never confirmed a switch
+  serviceBaudNegotiation();
 
   // Check for serial messages
   while (Serial.available() > 0) {
     char inByte = Serial.read();
 
+    if (binaryMode) {
+      frameParserFeed((uint8_t)inByte);
+      continue;
+    }
+
     if(inByte == START_MARKER) {
-      if (SYSTEM_DEBUG) {
-        Serial.println("SERIAL: Start marker '<' received.");
-      }
+      LOG_DEBUG(LOG_SYSTEM, "SERIAL: Start marker '<' received.");
       capturingMessage = true;
       message_pos = 0;
     }
     else if (inByte == END_MARKER) {
+      messageReceivedUs = micros();
       capturingMessage = false;
       message[message_pos] = '\0';  // Null terminate the string
-      if (SYSTEM_DEBUG) {
-        Serial.print("SERIAL: End marker '>' received. Processing: <");
-        Serial.print(message);
-        Serial.println(">");
-      }
+      LOG_DEBUG(LOG_SYSTEM, "SERIAL: End marker '>' received. Processing: <%s>", message);
       processMessage(message);
     }
     else if (capturingMessage) {
@@ -512,9 +939,7 @@ void loop() {
       message_pos++;
       if (message_pos >= MAX_MESSAGE_LENGTH) {
         capturingMessage = false;
-        if (SYSTEM_DEBUG) {
-          Serial.println("SERIAL ERROR: Message too long");
-        }
+        LOG_DEBUG(LOG_SYSTEM, "SERIAL ERROR: Message too long");
       }
     }
   }
@@ -522,99 +947,123 @@ void loop() {
   checkFeeder();
   checkHopper();
 
+  // Hand queued serial output to the hardware buffer without blocking
+  serialTxPump();
+
   // Watchdog timer removed. Main loop is robust and non-blocking; errors are logged and recovered in software.
 }
 
 // --- Sensor Read/Recovery Logic ---
-// Non-blocking sensor read function
-// Returns true if a new reading was initiated or is in progress, false if I2C is busy from a previous call
-// The actual reading is obtained via getLatestDistanceReading
-bool initiateDistanceRead(unsigned char deviceAddr) {
-  if (currentSensorState != SensorReadState::IDLE) {
-    // Already processing a read
-    return true; 
-  }
-  Wire.beginTransmission(deviceAddr); 
-  Wire.write(byte(0x00));      // sets distance data address (addr)
-  int endResult = Wire.endTransmission();      // stop transmitting
-  if (endResult != 0) {
-    Serial.print("ERROR: I2C end transmission failed (endResult: ");
-    Serial.print(endResult);
-    Serial.println(")");
-    // Attempt to recover I2C bus
-    Wire.end();
-    delay(10);
-    Wire.begin();
-    Serial.println("INFO: I2C bus reinitialized after error.");
-    return false;
+// Release the bus without waiting, serviceDistanceSensors() reinitializes it I2C_RECOVERY_MS later.
+// Conversions in flight are dropped and requested again once the bus is back.
+void startI2CRecovery() {
+  Wire.end();
+  i2cRecovering = true;
+  i2cRecoveryStartMillis = millis();
+  i2cRecoveries++;
+  for (uint8_t i = 0; i < MAX_DISTANCE_SENSORS; i++) {
+    distanceSensors[i].state = SensorReadState::IDLE;
   }
-  sensorRequestTime = micros(); // Use micros for finer delay control
-  currentSensorState = SensorReadState::REQUEST_SENT;
-  return true;
 }
 
-// Call this periodically to process the sensor reading stages
-// Returns true if a new reading is available in distanceReading global
-bool processSensorReading(unsigned char deviceAddr) {
-  if (currentSensorState == SensorReadState::REQUEST_SENT) {
-    if (micros() - sensorRequestTime >= SENSOR_READ_DELAY_US) {
-      currentSensorState = SensorReadState::WAITING_FOR_READING;
-      Wire.requestFrom(deviceAddr, (unsigned char)2); // request 2 bytes
-      sensorWaitStartTime = millis(); // Start timeout timer
-    }
-    return false; // Reading not yet available
-  }
+void backOffSensor(DistanceSensor &sensor) {
+  unsigned int interval = max(sensor.intervalMs * 2, max(sensor.minIntervalMs, (unsigned int)SENSOR_MIN_BACKOFF_MS));
+  sensor.intervalMs = min(interval, sensor.maxIntervalMs);
+}
 
-  if (currentSensorState == SensorReadState::WAITING_FOR_READING) {
-    if (Wire.available() >= 2) {
-      i2cReceiveBuffer[0] = Wire.read();
-      i2cReceiveBuffer[1] = Wire.read();
-      distanceReading = i2cReceiveBuffer[0];
-      distanceReading = distanceReading << 8;
-      distanceReading |= i2cReceiveBuffer[1];
-      currentSensorState = SensorReadState::IDLE; // Reset for next read
-      return true; // New reading is available
+// Record the result of a read and pick the time until the next one
+void finishSensorRead(uint8_t index, bool valid, unsigned short reading) {
+  DistanceSensor &sensor = distanceSensors[index];
+  sensor.state = SensorReadState::IDLE;
+  sensor.lastReadMillis = millis();
+  sensor.reads++;
+
+  if (valid) {
+    bool changed = !sensor.readingValid || abs((int)reading - (int)sensor.reading) > SENSOR_CHANGE_DISTANCE;
+    if (changed) {
+      sensor.intervalMs = sensor.minIntervalMs;
+    } else {
+      backOffSensor(sensor);
     }
-    
-    // Timeout check
-    if (millis() - sensorWaitStartTime > SENSOR_READ_TIMEOUT_MS) {
-      Serial.println("ERROR: Sensor read timeout. Attempting I2C recovery.");
-      // Default to a value that indicates NO part is detected.
-      distanceReading = UINT_MAX; 
-      // Attempt to recover I2C bus
-      Wire.end();
-      delay(10);
-      Wire.begin();
-      Serial.println("INFO: I2C bus reinitialized after sensor timeout.");
-      currentSensorState = SensorReadState::IDLE; // Reset for next attempt
-      return true; // Return true as we've "handled" it by providing a default.
+    sensor.reading = reading;
+    sensor.consecutiveFailures = 0;
+  } else {
+    // A missing or failing sensor must not crowd the bus
+    backOffSensor(sensor);
+    sensor.failures++;
+    if (sensor.consecutiveFailures < 255) {
+      sensor.consecutiveFailures++;
+    }
+    if (sensor.consecutiveFailures == SENSOR_MAX_FAILED_READS) {
+      LOG_WARN(LOG_FEEDER, "SENSOR %d (address %d): %d failed reads in a row", index, sensor.address,
+               SENSOR_MAX_FAILED_READS);
     }
-    
-    // Optional: Add a timeout here if Wire.available() never gets to 2
-    return false; // Reading not yet available
   }
-  return false; // Not in a state to process readings
+  sensor.readingValid = valid;
 }
 
-// Wrapper to maintain similar old behavior for checkFeeder, but now it's non-blocking
-// It will return the last successful reading, or 0 if a read is in progress or never completed.
-// It also initiates a new read if the sensor is idle.
-int ReadDistance(unsigned char device) {
-  initiateDistanceRead(device); // Try to start a new read if idle
-  // processSensorReading will be called in loop() to update distanceReading
-  // For now, checkFeeder will use the last known distanceReading
-  // This might mean it operates on slightly stale data if a read is in progress
-  return distanceReading; 
-}
+// Start or finish at most one bus transfer, call every loop.
+// Returns the index of the sensor whose read just finished, or -1.
+int serviceDistanceSensors() {
+  if (i2cRecovering) {
+    if (millis() - i2cRecoveryStartMillis < I2C_RECOVERY_MS) {
+      return -1;
+    }
+    Wire.begin();
+    Wire.setWireTimeout(I2C_TIMEOUT_US, true);
+    i2cRecovering = false;
+    LOG_INFO(LOG_FEEDER, "INFO: I2C bus reinitialized.");
+  }
 
-// New function for a more robust way to get the latest reading
-// Returns true if 'reading' is updated with a fresh value, false otherwise.
-bool getLatestDistanceReading(unsigned short &reading) {
-    if (processSensorReading(distanceSensorAddress)) {
-        reading = distanceReading;
-        return true;
+  for (uint8_t n = 0; n < MAX_DISTANCE_SENSORS; n++) {
+    uint8_t index = (nextSensor + n) % MAX_DISTANCE_SENSORS;
+    DistanceSensor &sensor = distanceSensors[index];
+    if (sensor.address == 0) {
+      continue;
     }
-    return false;
+
+    if (sensor.state == SensorReadState::REQUEST_SENT) {
+      if (micros() - sensor.requestMicros < SENSOR_CONVERSION_US) {
+        continue;
+      }
+      nextSensor = (index + 1) % MAX_DISTANCE_SENSORS;
+      if (Wire.requestFrom(sensor.address, (unsigned char)2) >= 2 && Wire.available() >= 2) {
+        unsigned short reading = Wire.read();
+        reading = (reading << 8) | Wire.read();
+        finishSensorRead(index, true, reading);
+        return index;
+      }
+      LOG_DEBUG(LOG_FEEDER, "SENSOR %d: read failed", index);
+      finishSensorRead(index, false, 0);
+      if (Wire.getWireTimeoutFlag()) {
+        Wire.clearWireTimeoutFlag();
+        startI2CRecovery();
+      }
+      return index;
+    }
+
+    if (millis() - sensor.lastReadMillis < sensor.intervalMs) {
+      continue;
+    }
+    nextSensor = (index + 1) % MAX_DISTANCE_SENSORS;
+    Wire.beginTransmission(sensor.address);
+    Wire.write(byte(0x00)); // sets distance data address (addr)
+    int endResult = Wire.endTransmission();
+    if (endResult != 0) {
+      LOG_DEBUG(LOG_FEEDER, "SENSOR %d: I2C end transmission failed (endResult: %d)", index, endResult);
+      finishSensorRead(index, false, 0);
+      // An absent sensor only leaves its address unacknowledged (2), anything else can leave the bus stuck
+      if (endResult != 2) {
+        Wire.clearWireTimeoutFlag();
+        startI2CRecovery();
+      }
+      return index;
+    }
+    sensor.requestMicros = micros();
+    sensor.state = SensorReadState::REQUEST_SENT;
+    return -1;
+  }
+  return -1;
 }
 
 // HOW TO CHANGE DEPTH SENSOR DEVICE I2C ADDRESS_____________________________________________________________________________
@@ -0,0 +1,249 @@
+/*
+ * Binary Framed Serial Protocol
+ * ----------------------------
+ * Shared by conveyor_jets.cpp, sorter.cpp and hopper_feeder.cpp.
+ *
+ * Every controller boots in the legacy ASCII mode (<...> messages). Sending <P1> switches
+ * to binary mode; the controller answers "Binary mode" and from then on only accepts frames.
+ * A 'P' frame with payload 0 switches back and is answered with "ASCII mode".
+ *
+ * Frame layout:
+ *   [SYNC 0xA5][LEN][OPCODE][SEQ][PAYLOAD ...][CRC8]
+ *   - LEN counts OPCODE + SEQ + PAYLOAD
+ *   - CRC8 (poly 0x07, init 0x00) covers LEN, OPCODE, SEQ and PAYLOAD
+ *   - Multi-byte integers are little endian
+ *
+ * Command opcodes are the ASCII command letters. Commands with a fixed binary payload are
+ * listed below; any other opcode carries the ASCII arguments as payload and is handed to
+ * processMessage() exactly as if it had arrived as <OPCODE + PAYLOAD>. Such a frame is
+ * ACKed only if processMessage() accepted the command, otherwise NAKed with its reason.
+ *   't' [u32 ping seq]           'j' [u8 jet]
+ *   'J' [u8 jet][u32 fire at us] 'X' [u8 jet][u32 fire at us]
+ *   'c' [u16 rpm]                'm' [u16 bin]
+ *   'p' [u16 pause ms]           'P' [u8 mode]
+ *   'K' [u8 jet][u32 position]   'k' [u8 jet][u32 position]
+ *   'Q' [u16 id][u16 bin][u32 not before us]  'x' [u16 id]
+ *   'e' [u16 odometry interval ms]
+ *
+ * Every command frame is answered with an ACK or NAK frame echoing its SEQ:
+ *   ACK: opcode 0x06, payload [u8 acked opcode]
+ *   NAK: opcode 0x15, payload [u8 rejected opcode][u8 reason]
+ *
+ * Device events sent as frames in binary mode (SEQ 0):
+ *   'T' [u32 ping seq][u32 micros]  clock sync pong
+ *   'M' [u16 bin]([u16 id])         sorter move complete, with the id for queued moves
+ *   'O' [u32 micros][u32 position]  conveyor odometry sample
+ *   'D' [u16 from bin][u16 to bin][u32 duration us][u32 x us][u32 y us]  sorter move duration, sent before 'M'
+ *
+ * Other device output (Ready, Settings updated, errors, logs) stays newline-terminated text
+ * in both modes. Text never contains the sync byte, so the host can split the two.
+ *
+ * Baud Rate Negotiation
+ * ---------------------
+ * Every controller boots at SERIAL_DEFAULT_BAUD. Before sending settings the host may ask
+ * for a faster rate (ASCII mode only):
+ *   host <U115200>  -> device "Baud: 115200" at the old rate, then switches
+ *   host <u>        -> device "Baud OK" at the new rate
+ * If the confirmation does not arrive within BAUD_CONFIRM_TIMEOUT_MS the device falls back
+ * to SERIAL_DEFAULT_BAUD and sends "Ready" again.
+ */
+
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include "serial_log.h"
+
+#define FRAME_SYNC 0xA5
+#define FRAME_MAX_PAYLOAD 64
+
+#define FRAME_OP_ACK 0x06
+#define FRAME_OP_NAK 0x15
+
+// NAK reasons, FRAME_OK is returned by processMessage() for an accepted command
+#define FRAME_OK 0
+#define FRAME_NAK_CRC 1      // frame was corrupted
+#define FRAME_NAK_INVALID 2  // payload has the wrong size or value
+#define FRAME_NAK_BUSY 3     // command not allowed in the current state
+#define FRAME_NAK_FULL 4     // a device queue is full
+
+// Implemented by each sketch
+void processFrame(uint8_t opcode, uint8_t seq, uint8_t *payload, uint8_t payloadLength);
+uint8_t processMessage(char *message); // returns FRAME_OK or a NAK reason
+
+#define SERIAL_DEFAULT_BAUD 9600UL
+#define BAUD_CONFIRM_TIMEOUT_MS 2000 // longer than the host's confirm timeout so the host reverts first
+
+bool binaryMode = false;
+
+unsigned long serialBaud = SERIAL_DEFAULT_BAUD;
+bool baudConfirmPending = false;
+unsigned long baudChangedAt = 0;
+
+enum class FrameParseState : uint8_t {
+  WAIT_SYNC,
+  WAIT_LENGTH,
+  READ_BODY,
+  READ_CRC
+};
+
+struct FrameParser {
+  FrameParseState state;
+  uint8_t length;
+  uint8_t pos;
+  uint8_t crc;
+  uint8_t body[FRAME_MAX_PAYLOAD + 2]; // opcode, seq, payload
+};
+
+FrameParser frameParser = { FrameParseState::WAIT_SYNC, 0, 0, 0, {0} };
+
+uint8_t crc8Update(uint8_t crc, uint8_t data) {
+  crc ^= data;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+uint16_t frameReadU16(const uint8_t *data) {
+  return (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+}
+
+uint32_t frameReadU32(const uint8_t *data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void frameWriteU16(uint8_t *data, uint16_t value) {
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+}
+
+void frameWriteU32(uint8_t *data, uint32_t value) {
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+  data[2] = (value >> 16) & 0xFF;
+  data[3] = (value >> 24) & 0xFF;
+}
+
+void sendFrame(uint8_t opcode, uint8_t seq, const uint8_t *payload, uint8_t payloadLength) {
+  uint8_t header[4] = { FRAME_SYNC, (uint8_t)(payloadLength + 2), opcode, seq };
+  uint8_t crc = 0;
+  for (uint8_t i = 1; i < 4; i++) crc = crc8Update(crc, header[i]);
+  for (uint8_t i = 0; i < payloadLength; i++) crc = crc8Update(crc, payload[i]);
+  Link.write(header, 4);
+  if (payloadLength > 0) Link.write(payload, payloadLength);
+  Link.write(crc);
+}
+
+void sendAck(uint8_t seq, uint8_t opcode) {
+  sendFrame(FRAME_OP_ACK, seq, &opcode, 1);
+}
+
+void sendNak(uint8_t seq, uint8_t opcode, uint8_t reason) {
+  uint8_t payload[2] = { opcode, reason };
+  sendFrame(FRAME_OP_NAK, seq, payload, 2);
+}
+
+// Hand a frame with an ASCII argument payload to the sketch's legacy message handler
+void processTextFrame(uint8_t opcode, uint8_t seq, uint8_t *payload, uint8_t payloadLength) {
+  static char message[FRAME_MAX_PAYLOAD + 2];
+  message[0] = (char)opcode;
+  memcpy(&message[1], payload, payloadLength);
+  message[payloadLength + 1] = '\0';
+  uint8_t status = processMessage(message);
+  if (status == FRAME_OK) {
+    sendAck(seq, opcode);
+  } else {
+    sendNak(seq, opcode, status);
+  }
+}
+
+// Feed one received byte. Complete frames are dispatched to processFrame(),
+// corrupted frames are answered with a CRC NAK.
+void frameParserFeed(uint8_t inByte) {
+  FrameParser &p = frameParser;
+  switch (p.state) {
+    case FrameParseState::WAIT_SYNC:
+      if (inByte == FRAME_SYNC) p.state = FrameParseState::WAIT_LENGTH;
+      break;
+
+    case FrameParseState::WAIT_LENGTH:
+      if (inByte < 2 || inByte > FRAME_MAX_PAYLOAD + 2) {
+        p.state = (inByte == FRAME_SYNC) ? FrameParseState::WAIT_LENGTH : FrameParseState::WAIT_SYNC;
+        break;
+      }
+      p.length = inByte;
+      p.pos = 0;
+      p.crc = crc8Update(0, inByte);
+      p.state = FrameParseState::READ_BODY;
+      break;
+
+    case FrameParseState::READ_BODY:
+      p.body[p.pos++] = inByte;
+      p.crc = crc8Update(p.crc, inByte);
+      if (p.pos >= p.length) p.state = FrameParseState::READ_CRC;
+      break;
+
+    case FrameParseState::READ_CRC:
+      p.state = FrameParseState::WAIT_SYNC;
+      if (inByte != p.crc) {
+        sendNak(p.body[1], p.body[0], FRAME_NAK_CRC);
+        break;
+      }
+      processFrame(p.body[0], p.body[1], &p.body[2], p.length - 2);
+      break;
+  }
+}
+
+bool isSupportedBaud(unsigned long baud) {
+  return baud == 9600UL || baud == 115200UL || baud == 250000UL || baud == 500000UL;
+}
+
+void requestBaudChange(unsigned long baud) {
+  if (binaryMode) {
+    Link.println("Error: Baud change requires ASCII mode");
+    return;
+  }
+  if (!isSupportedBaud(baud)) {
+    Link.println("Error: Unsupported baud rate");
+    return;
+  }
+  Link.print("Baud: ");
+  Link.println(baud);
+  serialTxFlush(); // the answer has to leave at the old rate
+  Serial.end();
+  Serial.begin(baud);
+  serialBaud = baud;
+  baudConfirmPending = true;
+  baudChangedAt = millis();
+}
+
+void confirmBaudChange() {
+  if (!baudConfirmPending) return;
+  baudConfirmPending = false;
+  Link.println("Baud OK");
+}
+
+// Call every loop: falls back to the default rate if the host never confirmed the switch
+void serviceBaudNegotiation() {
+  if (!baudConfirmPending || millis() - baudChangedAt < BAUD_CONFIRM_TIMEOUT_MS) return;
+  baudConfirmPending = false;
+  Serial.end();
+  Serial.begin(SERIAL_DEFAULT_BAUD);
+  serialBaud = SERIAL_DEFAULT_BAUD;
+  Link.println("Ready");
+}
+
+// Handles 'U<baud>' and 'u', returns true if the message was consumed
+bool processBaudMessage(char *message) {
+  if (message[0] == 'U') {
+    requestBaudChange(strtoul(message + 1, NULL, 10));
+    return true;
+  }
+  if (message[0] == 'u') {
+    confirmBaudChange();
+    return true;
+  }
+  return false;
+}
+
+#endif // SERIAL_LINK_H
@@ -0,0 +1,205 @@
+/*
+ * Non-blocking Serial Output and Runtime Log Levels
+ * -------------------------------------------------
+ * Shared by conveyor_jets.cpp, sorter.cpp and hopper_feeder.cpp.
+ *
+ * All serial output goes through two TX ring buffers that serialTxPump() moves into the
+ * hardware serial buffer from loop(), never writing more than Serial.availableForWrite():
+ *
+ *   Link  protocol output (Ready, Settings updated, Error:, T:, MC:, frames). Never dropped
+ *         and always sent before any diagnostic text. Only blocks if its own ring is full.
+ *   LOG_* diagnostics, formatted with vsnprintf (no float support, scale values instead).
+ *         Whole lines are handed to the hardware buffer only when they fit, so protocol
+ *         output never waits behind more than what is already in the hardware buffer.
+ *         When the ring is full the oldest lines are dropped and counted.
+ *
+ * Levels are set per subsystem at runtime with <L<SUBSYSTEM>,<LEVEL>> (SUBSYSTEM 255 = all),
+ * answered with "Log level: <SUBSYSTEM>,<LEVEL>".
+ */
+
+#ifndef SERIAL_LOG_H
+#define SERIAL_LOG_H
+
+#include <stdarg.h>
+
+// Subsystems
+#define LOG_SYSTEM 0
+#define LOG_CONVEYOR 1
+#define LOG_FEEDER 2
+#define LOG_HOPPER 3
+#define LOG_SORTER 4
+#define LOG_SUBSYSTEM_COUNT 5
+#define LOG_ALL 255
+
+// Levels
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LINK_TX_BUFFER_SIZE
+#define LINK_TX_BUFFER_SIZE 96
+#endif
+#ifndef LOG_TX_BUFFER_SIZE
+#define LOG_TX_BUFFER_SIZE 192
+#endif
+#define LOG_MAX_LINE 64 // never more than the hardware TX buffer, so a line can be handed over whole
+
+uint8_t logLevels[LOG_SUBSYSTEM_COUNT] = { LOG_LEVEL_WARN, LOG_LEVEL_WARN, LOG_LEVEL_WARN, LOG_LEVEL_WARN, LOG_LEVEL_WARN };
+uint16_t logDroppedLines = 0;
+
+struct TxRing {
+  uint8_t *data;
+  uint16_t size;
+  uint16_t head;
+  uint16_t count;
+};
+
+uint8_t linkTxData[LINK_TX_BUFFER_SIZE];
+uint8_t logTxData[LOG_TX_BUFFER_SIZE];
+TxRing linkTx = { linkTxData, LINK_TX_BUFFER_SIZE, 0, 0 };
+TxRing logTx = { logTxData, LOG_TX_BUFFER_SIZE, 0, 0 }; // stores [length][line bytes] records
+
+void txRingPush(TxRing &ring, uint8_t value) {
+  ring.data[(ring.head + ring.count) % ring.size] = value;
+  ring.count++;
+}
+
+uint8_t txRingPeek(const TxRing &ring, uint16_t offset) {
+  return ring.data[(ring.head + offset) % ring.size];
+}
+
+void txRingSkip(TxRing &ring, uint16_t length) {
+  ring.head = (ring.head + length) % ring.size;
+  ring.count -= length;
+}
+
+// Move queued output into the hardware buffer without blocking. Call every loop.
+void serialTxPump() {
+  int room = Serial.availableForWrite();
+
+  // Protocol output first, byte by byte
+  while (room > 0 && linkTx.count > 0) {
+    Serial.write(txRingPeek(linkTx, 0));
+    txRingSkip(linkTx, 1);
+    room--;
+  }
+  if (linkTx.count > 0) return;
+
+  // Diagnostics only as whole lines so they never split a protocol line
+  while (logTx.count > 0) {
+    uint8_t length = txRingPeek(logTx, 0);
+    if (length > room) return;
+    for (uint8_t i = 1; i <= length; i++) {
+      Serial.write(txRingPeek(logTx, i));
+    }
+    txRingSkip(logTx, length + 1);
+    room -= length;
+  }
+}
+
+// Send all protocol output before the caller touches the serial port (e.g. a baud change)
+void serialTxFlush() {
+  while (linkTx.count > 0) {
+    serialTxPump();
+  }
+  Serial.flush();
+}
+
+class LinkOutput : public Print {
+public:
+  size_t write(uint8_t value) override {
+    // Protocol output is never dropped; wait for room if a burst overflows the ring
+    while (linkTx.count >= linkTx.size) {
+      serialTxPump();
+    }
+    txRingPush(linkTx, value);
+    return 1;
+  }
+  using Print::write;
+};
+
+LinkOutput Link;
+
+void logQueueLine(const char *line, uint8_t length) {
+  // Drop the oldest lines until the new one fits
+  while (logTx.count + length + 1 > logTx.size) {
+    txRingSkip(logTx, txRingPeek(logTx, 0) + 1);
+    logDroppedLines++;
+  }
+  txRingPush(logTx, length);
+  for (uint8_t i = 0; i < length; i++) {
+    txRingPush(logTx, (uint8_t)line[i]);
+  }
+}
+
+// Format a line into the log ring. Use the LOG_* macros so disabled levels cost nothing.
+void logWrite(const char *format, ...) {
+  char line[LOG_MAX_LINE];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf_P(line, sizeof(line) - 2, format, args);
+  va_end(args);
+  if (length < 0) return;
+  if (length > (int)sizeof(line) - 3) length = sizeof(line) - 3; // truncated
+  line[length++] = '\r';
+  line[length++] = '\n';
+
+  // Report earlier drops once there is room again, ahead of the new line
+  if (logDroppedLines > 0 && logTx.count == 0) {
+    char notice[32];
+    uint16_t dropped = logDroppedLines;
+    logDroppedLines = 0;
+    int noticeLength = snprintf(notice, sizeof(notice), "LOG: %u lines dropped\r\n", dropped);
+    logQueueLine(notice, noticeLength);
+  }
+  logQueueLine(line, length);
+}
+
+bool logEnabled(uint8_t subsystem, uint8_t level) {
+  return subsystem < LOG_SUBSYSTEM_COUNT && logLevels[subsystem] >= level;
+}
+
+#define LOG(subsystem, level, format, ...)                                                                     \
+  do {                                                                                                         \
+    if (logEnabled(subsystem, level)) logWrite(PSTR(format), ##__VA_ARGS__);                                   \
+  } while (0)
+#define LOG_ERROR(subsystem, format, ...) LOG(subsystem, LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#define LOG_WARN(subsystem, format, ...) LOG(subsystem, LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#define LOG_INFO(subsystem, format, ...) LOG(subsystem, LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define LOG_DEBUG(subsystem, format, ...) LOG(subsystem, LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+
+void setLogLevel(uint8_t subsystem, uint8_t level) {
+  if (level > LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+  if (subsystem == LOG_ALL) {
+    for (uint8_t i = 0; i < LOG_SUBSYSTEM_COUNT; i++) logLevels[i] = level;
+  } else if (subsystem < LOG_SUBSYSTEM_COUNT) {
+    logLevels[subsystem] = level;
+  }
+}
+
+// Handles 'L<SUBSYSTEM>,<LEVEL>', returns true if the message was consumed
+bool processLogMessage(char *message) {
+  if (message[0] != 'L') return false;
+
+  char *comma = strchr(message + 1, ',');
+  if (comma == NULL) {
+    Link.println("Error: Invalid log level message format");
+    return true;
+  }
+  uint8_t subsystem = (uint8_t)atoi(message + 1);
+  uint8_t level = (uint8_t)atoi(comma + 1);
+  if (subsystem != LOG_ALL && subsystem >= LOG_SUBSYSTEM_COUNT) {
+    Link.println("Error: Unknown log subsystem");
+    return true;
+  }
+  setLogLevel(subsystem, level);
+  Link.print("Log level: ");
+  Link.print(subsystem);
+  Link.print(",");
+  Link.println(subsystem == LOG_ALL ? logLevels[0] : logLevels[subsystem]);
+  return true;
+}
+
+#endif // SERIAL_LOG_H
@@ -4,8 +4,16 @@
  * All messages must be wrapped in angle brackets < >
  * 
  * Commands:
- * s,<GRID_DIMENSION>,<X_OFFSET>,<Y_OFFSET>,<X_STEPS_TO_LAST>,<Y_STEPS_TO_LAST>,<ACCELERATION>,<HOMING_SPEED>,<SPEED>,<ROW_MAJOR_ORDER>
+ * s,<GRID_DIMENSION>,<X_OFFSET>,<Y_OFFSET>,<X_STEPS_TO_LAST>,<Y_STEPS_TO_LAST>,<ACCELERATION>,<HOMING_SPEED>,<SPEED>,<ROW_MAJOR_ORDER>[,<HOMING_FAST_SPEED>,<Y_ACCELERATION>,<Y_SPEED>,<SYNCHRONIZED>,<S_CURVE_STEPS>]
  *    - Initialize settings for the sorter
+ *    - HOMING_FAST_SPEED (optional, 0 = off) adds a fast first approach to the endstops before the
+ *      slow approach at HOMING_SPEED
+ *    - ACCELERATION and SPEED are the X axis limits. Y_ACCELERATION and Y_SPEED (optional, 0 = same as X)
+ *      set the Y axis limits.
+ *    - SYNCHRONIZED (optional, 0 = off) slows the faster axis of each move down so both axes finish together,
+ *      the slower axis keeps its full limits
+ *    - S_CURVE_STEPS (optional, 0 = trapezoidal) ramps the acceleration up linearly over the first and down over the
+ *      last S_CURVE_STEPS steps of every move (jerk-limited start and stop)
  *    - Example: <s,3,100,100,1000,1000,10000,200,100,1>
  * 
  * m<BIN>
@@ -17,21 +25,105 @@
  *    - Example: <h>
  * 
  * a
- *    - Start homing sequence
+ *    - Start homing sequence, both axes home at the same time
  *    - Example: <a>
  * 
+ * t<SEQ>
+ *    - Clock sync ping, answered at any time (also before settings and during homing)
+ *    - Example: <t42>
+ * 
+ * P<MODE>
+ *    - Switch to the binary framed protocol (1), see serial_link.h
+ *    - Example: <P1>
+ * 
+ * L<SUBSYSTEM>,<LEVEL>
+ *    - Set a runtime log level (0 off .. 4 debug, subsystem 255 = all), see serial_log.h
+ *    - Example: <L4,3>
+ * 
+ * Q<ID>,<BIN>,<NOT_BEFORE_US>
+ *    - Queue a move to a bin that starts once the previous move is complete and the device
+ *      micros() has reached NOT_BEFORE_US. Up to MOVE_QUEUE_CAPACITY moves, kept in time order.
+ *    - Example: <Q17,5,48213377>
+ * 
+ * x<ID>
+ *    - Remove a queued move that has not started yet
+ *    - Example: <x17>
+ * 
+ * B<START_BIN>,<PHYSICAL_BIN>,<PHYSICAL_BIN>,...
+ *    - Write part of the bin map: the physical bins of the logical bins from START_BIN on. The map takes
+ *      effect once committed with N1, moves use the grid order until then.
+ *    - Example: <B1,61,60,73,72>
+ * 
+ * N<SAVE>
+ *    - N1 checks that the bin map is a permutation of the grid, applies it and stores it in EEPROM.
+ *      N0 clears it so bin numbers follow ROW_MAJOR_ORDER again.
+ *    - Example: <N1>
+ * 
+ * i<DELAY_MS>,<BIN>
+ *    - Park at BIN once the sorter has been idle for DELAY_MS after a move complete (BIN 0 = off).
+ *      Reset by the settings message.
+ *    - Example: <i3000,66>
+ * 
+ * V<EVERY_MOVES>,<IDLE_MS>
+ *    - Check the position after every EVERY_MOVES moves, once the sorter has been idle for IDLE_MS and no move is
+ *      queued: both axes re-approach their endstops, the drift is reported with VD and corrected, then the sorter
+ *      returns to its bin (EVERY_MOVES 0 = off). A move request cancels a check in progress. Reset by the settings
+ *      message.
+ *    - Example: <V200,3000>
+ * 
+ * d<TO_BIN> or d<FROM_BIN>,<TO_BIN>
+ *    - Predict the duration of a move without moving, from the current bin (the target of a move in progress)
+ *      or from FROM_BIN, answered with MP
+ *    - Example: <d12>, <d1,12>
+ * 
  * Responses:
  * MC: <BIN>
  *    - Move Complete message sent when sorter reaches target position
  *    - Example: MC: 1
  * 
+ * MC: <BIN>,<ID>
+ *    - Move Complete of a queued move
+ *    - Example: MC: 5,17
+ * 
+ * MT:<FROM_BIN>,<TO_BIN>,<DURATION_US>,<X_US>,<Y_US>
+ *    - Measured duration of a bin-to-bin move from its start to the move complete, sent right before MC,
+ *      and the time each axis took to stop
+ *    - Example: MT:1,5,412880,412644,208120
+ * 
+ * PK:<BIN>
+ *    - The sorter started parking at BIN. Parking moves are not confirmed with MC.
+ *    - Example: PK:66
+ * 
+ * VD:<X_DRIFT>,<Y_DRIFT>
+ *    - Result of a position check: steps between where each endstop triggered and where homing found it. Positive
+ *      means the endstop triggered at a higher step count than expected, so the axis was closer to its endstop
+ *      than the step count said. The position has been corrected.
+ *    - Example: VD:0,-4
+ * 
+ * MP:<FROM_BIN>,<TO_BIN>,<DURATION_US>
+ *    - Predicted move duration, the slower axis of the two trapezoidal speed profiles
+ *    - Example: MP:1,12,1524380
+ * 
+ * Bin map: <SIZE> / Bin map: off
+ *    - Answer to N, and sent after settings when a map stored in EEPROM matches the grid
+ *    - Example: Bin map: 144
+ * 
+ * T:<SEQ>,<MICROS>
+ *    - Clock sync pong with the device micros() at which the ping's end marker arrived
+ *    - Example: T:42,18345012
+ * 
  */
 
 #include "FastAccelStepper.h"
 #include <Wire.h>
+#include <EEPROM.h>
+#include "serial_link.h"
 
 // Increase MAX_MESSAGE_LENGTH to accommodate settings message
-#define MAX_MESSAGE_LENGTH 60 // Adjusted for longer messages
+#define MAX_MESSAGE_LENGTH 80 // Adjusted for longer messages
+#define MOVE_QUEUE_CAPACITY 8 // max number of pending queued moves
+#define MAX_MAPPED_BINS 225 // bin map covers grids up to 15 x 15 so physical bins fit a byte
+#define BIN_MAP_MAGIC 0xB1 // EEPROM layout: [magic][grid dimension][physical bin ...][crc8]
 
 // Other pin definitions remain the same
 #define AUTO_DISABLE true
@@ -48,19 +140,44 @@
 enum HomingState {
   NOT_HOMING,
   HOMING_START,
-  HOMING_Y_BACKWARD,
-  HOMING_X_BACKWARD,
-  HOMING_Y_OFFSET,
-  HOMING_X_OFFSET,
+  HOMING_AXES, // both axes look for their endstops, see AxisHomingPhase
   HOMING_WAIT_FOR_OFFSET,
   HOMING_COMPLETE,
   HOMING_ERROR
 };
 
+// Homing steps of a single axis
+enum AxisHomingPhase {
+  AXIS_POSITION,      // move to VERIFY_START_POSITION at the move limits (position check only)
+  AXIS_FAST_APPROACH, // run towards the endstop at HOMING_FAST_SPEED (only if set)
+  AXIS_RELEASE,       // run away from the endstop until it is released
+  AXIS_BACKOFF,       // move HOMING_BACKOFF_STEPS further away
+  AXIS_SLOW_APPROACH, // run towards the endstop at HOMING_SPEED, its trigger point sets the zero
+  AXIS_HOMED
+};
+
+// Homing progress and debounced endstop of one axis
+struct AxisHoming {
+  const char *name;
+  uint8_t stopPin;
+  FastAccelStepper *stepper;
+  AxisHomingPhase phase;
+  unsigned long phaseStartMillis;
+  bool rawPressed;         // last endstop reading
+  bool pressed;            // endstop reading that has been stable for ENDSTOP_DEBOUNCE_MS
+  unsigned long rawChangedMillis;
+  int32_t edgePosition;    // stepper position when the endstop last closed
+  int32_t drift;           // trigger point of the slow approach minus where homing put it
+};
+
 HomingState currentHomingState = NOT_HOMING;
 unsigned long homingStartMillis = 0;
-const unsigned long HOMING_TIMEOUT_MS = 30000; // 30 seconds timeout per axis move
-const int HOMING_BACKOFF_STEPS = 100; // Steps to back off after hitting switch
+const unsigned long HOMING_TIMEOUT_MS = 30000; // 30 seconds timeout per homing phase of an axis
+const int HOMING_BACKOFF_STEPS = 100; // Steps to back off after releasing the switch, also the zero's distance behind the trigger point
+const unsigned long ENDSTOP_DEBOUNCE_MS = 5; // endstop reading must be stable this long
+const int VERIFY_START_POSITION = 2 * HOMING_BACKOFF_STEPS; // position checks start HOMING_BACKOFF_STEPS before the trigger point
+AxisHoming xHoming = { "X", X_STOP_PIN };
+AxisHoming yHoming = { "Y", Y_STOP_PIN };
 
 // Device settings struct
 typedef struct {
@@ -73,6 +190,11 @@ typedef struct {
   int   HOMING_SPEED;
   int   SPEED;
   bool  ROW_MAJOR_ORDER; 
+  int   HOMING_FAST_SPEED; // 0 = single approach at HOMING_SPEED
+  int   Y_ACCELERATION; // ACCELERATION and SPEED are the X axis limits
+  int   Y_SPEED;
+  bool  SYNCHRONIZED; // both axes finish each move together
+  int   S_CURVE_STEPS; // steps over which the acceleration ramps up and down, 0 = trapezoidal profile
 } DeviceSettings;
 
 DeviceSettings settings;
@@ -84,6 +206,54 @@ int curBin = 0; // current bin number
 bool moveCompleteSent = true; // flag to indicate that a move complete "MC" message has been sent
 bool homing = false; // flag to indicate that the sorter is currently homing
 bool settingsInitialized = false; // flag to indicate settings have been received
+unsigned long messageReceivedUs = 0; // micros() when the end marker of the current message arrived
+
+// --- Move Queue ---
+// Moves queued with 'Q' start on their own as soon as the sorter is idle and their time has come,
+// so the host no longer needs a round trip per move. Kept sorted by start time.
+struct QueuedMove {
+  uint16_t id;
+  uint16_t bin;
+  unsigned long notBeforeUs; // device micros() before which the move may not start
+};
+QueuedMove moveQueue[MOVE_QUEUE_CAPACITY];
+uint8_t moveQueueCount = 0;
+bool queuedMoveActive = false; // the move in progress came from the queue
+uint16_t activeMoveId = 0;
+
+// --- Bin Map ---
+// Logical bin numbers (what the host sends) map to physical bins (grid order) so frequently used bins can be
+// placed close together. Without a map, or while one is being written, logical and physical bins are equal.
+uint8_t binMap[MAX_MAPPED_BINS]; // physical bin of logical bin i + 1
+bool binMapActive = false;
+
+// --- Idle Parking ---
+// An idle sorter moves to the park bin the host expects to be closest to the next part's bin.
+// The delay keeps the funnel in place until the last part has fallen through.
+int parkBin = 0; // 0 = parking off
+unsigned long parkDelayMs = 0;
+unsigned long idleSinceMs = 0; // millis() of the last move complete
+bool parkingActive = false; // a parking move is in progress
+
+// --- Position Verification ---
+// Open-loop step counts go wrong when steps are lost. A position check re-approaches both endstops like homing
+// does and corrects the position by the difference, without the full homing sequence.
+enum VerifyState {
+  NOT_VERIFYING,
+  VERIFY_AXES,  // both axes approach their endstops, see AxisHomingPhase
+  VERIFY_RETURN // back to the bin the sorter was at
+};
+VerifyState verifyState = NOT_VERIFYING;
+unsigned int verifyEveryMoves = 0; // 0 = off
+unsigned long verifyIdleMs = 0;
+unsigned int movesSinceVerify = 0;
+
+// --- Move Timing ---
+// Every bin-to-bin move reports how long it took so the host can learn the sorter's travel times
+int moveFromBin = 0; // bin the move in progress started from, 0 = not timed
+unsigned long moveStartUs = 0;
+unsigned long xMoveUs = 0; // time the X axis took to stop, 0 = still running
+unsigned long yMoveUs = 0;
 
 // ___________________________ STEPPER LIBRARY FUNCTIONS ___________________________
 
@@ -112,7 +282,7 @@ FastAccelStepper *yStepper = NULL;
 
 void setup() {
   Wire.begin(); 
-  Serial.begin(9600);
+  Serial.begin(SERIAL_DEFAULT_BAUD);
   engine.init();
 
   // ------- X STEPPER
@@ -138,7 +308,10 @@ void setup() {
   pinMode(X_STOP_PIN, INPUT_PULLUP);
   pinMode(Y_STOP_PIN, INPUT_PULLUP);
 
-  Serial.println("Ready"); // Indicate that the Arduino is ready to receive config init settings message
+  // Homing progress is reported at INFO
+  setLogLevel(LOG_SORTER, LOG_LEVEL_INFO);
+
+  Link.println("Ready"); // Indicate that the Arduino is ready to receive config init settings message
 }
 
 // ______________________________ FUNCTIONS ______________________________
@@ -148,7 +321,27 @@ void moveSorterToPosition(int xPos, int yPos, bool blocking = false) {
   yStepper->moveTo(yPos, blocking);
 }
 
-void moveToBin(int binNum, bool blocking = false) {
+int physicalBin(int binNum) {
+  return binMapActive ? binMap[binNum - 1] : binNum;
+}
+
+// Logical bin that maps to a physical bin
+int logicalBin(int physical) {
+  if (!binMapActive) {
+    return physical;
+  }
+  int binCount = settings.GRID_DIMENSION * settings.GRID_DIMENSION;
+  for (int i = 0; i < binCount; i++) {
+    if (binMap[i] == physical) {
+      return i + 1;
+    }
+  }
+  return physical;
+}
+
+// Stepper position of a bin (1-based, logical)
+void binToPosition(int binNum, int &xPos, int &yPos) {
+  binNum = physicalBin(binNum);
   int xIndex, yIndex;
   if (settings.ROW_MAJOR_ORDER) {
     // Row-major order (rows first)
@@ -159,23 +352,302 @@ void moveToBin(int binNum, bool blocking = false) {
     xIndex = (binNum - 1) / settings.GRID_DIMENSION;
     yIndex = (binNum - 1) % settings.GRID_DIMENSION;
   }
-  int xPos = xIndex * xStepsPerBin + settings.X_OFFSET;
-  int yPos = yIndex * yStepsPerBin + settings.Y_OFFSET;
+  xPos = xIndex * xStepsPerBin + settings.X_OFFSET;
+  yPos = yIndex * yStepsPerBin + settings.Y_OFFSET;
+}
+
+// Duration of a jerk-limited move (FastAccelStepper's linear acceleration): the acceleration rises linearly to
+// `accel` over the first S_CURVE_STEPS steps, which takes the constant jerk j = sqrt(accel^3 / (6 * S_CURVE_STEPS)),
+// and falls the same way over the last ones. In between the profile is trapezoidal.
+float sCurveMoveSeconds(long steps, float maxSpeed, float accel) {
+  float rampSteps = settings.S_CURVE_STEPS;
+  float jerk = sqrt(accel * accel * accel / (6.0 * rampSteps)); // steps/s^3
+  float rampSeconds = accel / jerk;
+  float rampSpeed = accel * rampSeconds / 2.0; // speed at the end of the jerk phase
+
+  // Time and distance from standstill to full speed
+  float toMaxSeconds, toMaxSteps;
+  if (maxSpeed <= rampSpeed) {
+    toMaxSeconds = sqrt(2.0 * maxSpeed / jerk);
+    toMaxSteps = jerk * toMaxSeconds * toMaxSeconds * toMaxSeconds / 6.0;
+  } else {
+    float accelSeconds = (maxSpeed - rampSpeed) / accel;
+    toMaxSeconds = rampSeconds + accelSeconds;
+    toMaxSteps = rampSteps + rampSpeed * accelSeconds + accel * accelSeconds * accelSeconds / 2.0;
+  }
+
+  if (steps >= 2.0 * toMaxSteps) {
+    return 2.0 * toMaxSeconds + (steps - 2.0 * toMaxSteps) / maxSpeed;
+  }
+  if (steps <= 2.0 * rampSteps) {
+    return 2.0 * cbrt(3.0 * steps / jerk); // never leaves the jerk phase
+  }
+  float halfSteps = steps / 2.0 - rampSteps;
+  float accelSeconds = (sqrt(rampSpeed * rampSpeed + 2.0 * accel * halfSteps) - rampSpeed) / accel;
+  return 2.0 * (rampSeconds + accelSeconds);
+}
+
+// Duration of a FastAccelStepper move over `steps` with the given speed (step interval) and acceleration.
+// Moves too short to reach full speed accelerate for half the distance and decelerate for the other half.
+unsigned long axisMoveTimeUs(long steps, long speedUs, long acceleration) {
+  if (steps < 0) steps = -steps;
+  if (steps == 0 || speedUs <= 0 || acceleration <= 0) {
+    return 0;
+  }
+  float maxSpeed = 1000000.0 / speedUs; // steps/s
+  float accel = acceleration;           // steps/s^2
+  float seconds;
+  if (settings.S_CURVE_STEPS > 0) {
+    seconds = sCurveMoveSeconds(steps, maxSpeed, accel);
+  } else if (steps >= maxSpeed * maxSpeed / accel) {
+    seconds = steps / maxSpeed + maxSpeed / accel;
+  } else {
+    seconds = 2.0 * sqrt(steps / accel);
+  }
+  return (unsigned long)(seconds * 1000000.0);
+}
+
+// Both axes start together, so a move lasts as long as its slower axis
+unsigned long predictMoveTimeUs(int fromBin, int toBin) {
+  int fromX, fromY, toX, toY;
+  binToPosition(fromBin, fromX, fromY);
+  binToPosition(toBin, toX, toY);
+  unsigned long xUs = axisMoveTimeUs((long)toX - fromX, settings.SPEED, settings.ACCELERATION);
+  unsigned long yUs = axisMoveTimeUs((long)toY - fromY, settings.Y_SPEED, settings.Y_ACCELERATION);
+  return xUs > yUs ? xUs : yUs;
+}
+
+// Set each axis to its own limits. In synchronized mode the axis that would finish first is slowed down so both
+// finish together: scaling the step interval by k and the acceleration by 1/k² stretches a trapezoidal profile
+// to exactly k times its duration. A jerk-limited profile stretches the same way with the ramp length unchanged.
+void applyAxisLimits(long xSteps, long ySteps) {
+  long xSpeedUs = settings.SPEED;
+  long xAccel = settings.ACCELERATION;
+  long ySpeedUs = settings.Y_SPEED;
+  long yAccel = settings.Y_ACCELERATION;
+
+  if (settings.SYNCHRONIZED) {
+    unsigned long xUs = axisMoveTimeUs(xSteps, xSpeedUs, xAccel);
+    unsigned long yUs = axisMoveTimeUs(ySteps, ySpeedUs, yAccel);
+    if (xUs > 0 && yUs > xUs) {
+      float k = (float)yUs / xUs;
+      xSpeedUs = (long)(xSpeedUs * k);
+      xAccel = max((long)(xAccel / (k * k)), 1L);
+    } else if (yUs > 0 && xUs > yUs) {
+      float k = (float)xUs / yUs;
+      ySpeedUs = (long)(ySpeedUs * k);
+      yAccel = max((long)(yAccel / (k * k)), 1L);
+    }
+  }
+
+  xStepper->setSpeedInUs(xSpeedUs);
+  xStepper->setAcceleration(xAccel);
+  yStepper->setSpeedInUs(ySpeedUs);
+  yStepper->setAcceleration(yAccel);
+}
+
+void moveToBin(int binNum, bool blocking = false) {
+  int xPos, yPos;
+  binToPosition(binNum, xPos, yPos);
+  applyAxisLimits((long)xPos - xStepper->getCurrentPosition(), (long)yPos - yStepper->getCurrentPosition());
+  xMoveUs = 0;
+  yMoveUs = 0;
   xStepper->moveTo(xPos, blocking);
   yStepper->moveTo(yPos, blocking);
 }
 
+// Note when each axis of a timed move has stopped
+void trackAxisMoveTimes() {
+  if (moveFromBin == 0) {
+    return;
+  }
+  unsigned long elapsedUs = micros() - moveStartUs;
+  if (xMoveUs == 0 && !xStepper->isRunning()) xMoveUs = max(elapsedUs, 1UL);
+  if (yMoveUs == 0 && !yStepper->isRunning()) yMoveUs = max(elapsedUs, 1UL);
+}
+
+
+// ______________________________ BIN MAP ______________________________
+
+// True if every physical bin of the grid appears exactly once in the map
+bool binMapIsPermutation(int binCount) {
+  uint8_t seen[(MAX_MAPPED_BINS + 7) / 8] = {0};
+  for (int i = 0; i < binCount; i++) {
+    int physical = binMap[i];
+    if (physical < 1 || physical > binCount || (seen[(physical - 1) / 8] & (1 << ((physical - 1) % 8)))) {
+      return false;
+    }
+    seen[(physical - 1) / 8] |= 1 << ((physical - 1) % 8);
+  }
+  return true;
+}
+
+// Load the map stored for the current grid, or fall back to the grid order
+void loadBinMap() {
+  binMapActive = false;
+  int binCount = settings.GRID_DIMENSION * settings.GRID_DIMENSION;
+  if (binCount > MAX_MAPPED_BINS || EEPROM.read(0) != BIN_MAP_MAGIC || EEPROM.read(1) != settings.GRID_DIMENSION) {
+    return;
+  }
+  uint8_t crc = 0;
+  for (int i = 0; i < binCount; i++) {
+    binMap[i] = EEPROM.read(2 + i);
+    crc = crc8Update(crc, binMap[i]);
+  }
+  if (crc == EEPROM.read(2 + binCount) && binMapIsPermutation(binCount)) {
+    binMapActive = true;
+  }
+}
 
-void processSettings(char *message) {
+// EEPROM.update only writes bytes that changed, so resending the same map does not wear the EEPROM
+void saveBinMap() {
+  int binCount = settings.GRID_DIMENSION * settings.GRID_DIMENSION;
+  uint8_t crc = 0;
+  EEPROM.update(0, BIN_MAP_MAGIC);
+  EEPROM.update(1, settings.GRID_DIMENSION);
+  for (int i = 0; i < binCount; i++) {
+    EEPROM.update(2 + i, binMap[i]);
+    crc = crc8Update(crc, binMap[i]);
+  }
+  EEPROM.update(2 + binCount, crc);
+}
+
+void reportBinMap() {
+  if (binMapActive) {
+    Link.print("Bin map: ");
+    Link.println(settings.GRID_DIMENSION * settings.GRID_DIMENSION);
+  } else {
+    Link.println("Bin map: off");
+  }
+}
+
+// Report the duration of the move that just completed, see 'MT:' above
+void sendMoveTime(int binNum) {
+  if (moveFromBin == 0) {
+    return;
+  }
+  unsigned long durationUs = micros() - moveStartUs;
+  trackAxisMoveTimes();
+  if (binaryMode) {
+    uint8_t payload[16];
+    frameWriteU16(payload, moveFromBin);
+    frameWriteU16(&payload[2], binNum);
+    frameWriteU32(&payload[4], durationUs);
+    frameWriteU32(&payload[8], xMoveUs);
+    frameWriteU32(&payload[12], yMoveUs);
+    sendFrame('D', 0, payload, sizeof(payload));
+  } else {
+    Link.print("MT:");
+    Link.print(moveFromBin);
+    Link.print(",");
+    Link.print(binNum);
+    Link.print(",");
+    Link.print(durationUs);
+    Link.print(",");
+    Link.print(xMoveUs);
+    Link.print(",");
+    Link.println(yMoveUs);
+  }
+  moveFromBin = 0;
+}
+
+void sendMoveComplete(int binNum) {
+  idleSinceMs = millis();
+  if (binaryMode) {
+    uint8_t payload[4];
+    frameWriteU16(payload, binNum);
+    if (queuedMoveActive) frameWriteU16(&payload[2], activeMoveId);
+    sendFrame('M', 0, payload, queuedMoveActive ? 4 : 2);
+    return;
+  }
+  Link.print("MC: ");
+  if (queuedMoveActive) {
+    Link.print(binNum);
+    Link.print(",");
+    Link.println(activeMoveId);
+  } else {
+    Link.println(binNum);
+  }
+}
+
+// Insert a move into the queue in start time order. Returns false if the queue is full.
+bool queueMove(uint16_t id, uint16_t bin, unsigned long notBeforeUs) {
+  if (moveQueueCount >= MOVE_QUEUE_CAPACITY) {
+    return false;
+  }
+  unsigned long nowUs = micros();
+  long offset = (long)(notBeforeUs - nowUs);
+  uint8_t insertIndex = moveQueueCount;
+  while (insertIndex > 0 && (long)(moveQueue[insertIndex - 1].notBeforeUs - nowUs) > offset) {
+    moveQueue[insertIndex] = moveQueue[insertIndex - 1];
+    insertIndex--;
+  }
+  moveQueue[insertIndex].id = id;
+  moveQueue[insertIndex].bin = bin;
+  moveQueue[insertIndex].notBeforeUs = notBeforeUs;
+  moveQueueCount++;
+  return true;
+}
+
+// Remove a queued move that has not started. Returns false if it is not pending.
+bool cancelQueuedMove(uint16_t id) {
+  for (uint8_t i = 0; i < moveQueueCount; i++) {
+    if (moveQueue[i].id == id) {
+      moveQueueCount--;
+      for (uint8_t j = i; j < moveQueueCount; j++) {
+        moveQueue[j] = moveQueue[j + 1];
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Give up a position check in progress so a move can take over. The step count is still valid, an axis that
+// already found its endstop has been corrected. Returns true if a check was in progress.
+bool abortVerification() {
+  if (verifyState == NOT_VERIFYING) {
+    return false;
+  }
+  LOG_DEBUG(LOG_SORTER, "Position check cancelled");
+  verifyState = NOT_VERIFYING;
+  return true;
+}
+
+// Start a move to a bin, or confirm right away if the sorter is already there
+void requestMoveToBin(int binNum) {
+  binNum = constrain(binNum, 1, settings.GRID_DIMENSION * settings.GRID_DIMENSION);
+
+  bool interrupted = abortVerification() || parkingActive;
+  if (curBin != binNum || interrupted) {
+    movesSinceVerify++;
+    // After homing (curBin 0) the sorter rests at the offsets, which is where physical bin 1 is.
+    // A move that interrupts parking or a position check starts somewhere between two bins and is not timed.
+    moveFromBin = interrupted ? 0 : (curBin > 0 ? curBin : logicalBin(1));
+    parkingActive = false;
+    moveStartUs = micros();
+    curBin = binNum;
+    moveToBin(binNum);
+    moveCompleteSent = false;
+  } else {
+    // Already at the bin, send MC immediately if needed
+    if (moveCompleteSent) {
+      sendMoveComplete(curBin);
+    }
+  }
+}
+
+// Returns false if the message does not carry all required settings
+bool processSettings(char *message) {
   // Parse settings from message
-  // Expected format: 's,<GRID_DIMENSION>,<X_OFFSET>,<Y_OFFSET>,<X_STEPS_TO_LAST>,<Y_STEPS_TO_LAST>,<ACCELERATION>,<HOMING_SPEED>,<SPEED>,<ROW_MAJOR_ORDER>'
+  // Expected format: 's,<GRID_DIMENSION>,<X_OFFSET>,<Y_OFFSET>,<X_STEPS_TO_LAST>,<Y_STEPS_TO_LAST>,<ACCELERATION>,<HOMING_SPEED>,<SPEED>,<ROW_MAJOR_ORDER>[,<HOMING_FAST_SPEED>]'
   char *token;
-  int values[10]; // Adjusted for 9 settings
+  int values[14]; // 9 required settings and the optional ones from HOMING_FAST_SPEED on
   int valueIndex = 0;
 
   // Skip 's,' and start tokenizing
   token = strtok(&message[2], ",");
-  while (token != NULL && valueIndex < 10) {
+  while (token != NULL && valueIndex < 14) {
     values[valueIndex++] = atoi(token);
     token = strtok(NULL, ",");
   }
@@ -190,16 +662,20 @@ void processSettings(char *message) {
     settings.HOMING_SPEED = values[6];
     settings.SPEED = values[7];
     settings.ROW_MAJOR_ORDER = (values[8] != 0); // Convert to boolean
+    settings.HOMING_FAST_SPEED = valueIndex >= 10 ? max(values[9], 0) : 0;
+    settings.Y_ACCELERATION = valueIndex >= 11 && values[10] > 0 ? values[10] : settings.ACCELERATION;
+    settings.Y_SPEED = valueIndex >= 12 && values[11] > 0 ? values[11] : settings.SPEED;
+    settings.SYNCHRONIZED = valueIndex >= 13 && values[12] != 0;
+    settings.S_CURVE_STEPS = valueIndex >= 14 ? max(values[13], 0) : 0;
 
     // Recalculate steps per bin
     xStepsPerBin = (settings.X_STEPS_TO_LAST - settings.X_OFFSET) / (settings.GRID_DIMENSION -1);
     yStepsPerBin = (settings.Y_STEPS_TO_LAST - settings.Y_OFFSET) / (settings.GRID_DIMENSION -1);
 
     // Update stepper settings
-    xStepper->setAcceleration(settings.ACCELERATION);
-    yStepper->setAcceleration(settings.ACCELERATION);
-    xStepper->setSpeedInUs(settings.SPEED);
-    yStepper->setSpeedInUs(settings.SPEED);
+    applyAxisLimits(0, 0);
+    xStepper->setLinearAcceleration(settings.S_CURVE_STEPS);
+    yStepper->setLinearAcceleration(settings.S_CURVE_STEPS);
 
     // Reset all state variables to their initial values
     currentHomingState = NOT_HOMING;
@@ -207,6 +683,14 @@ void processSettings(char *message) {
     curBin = 0;
     moveCompleteSent = true;
     homing = false;
+    moveQueueCount = 0;
+    queuedMoveActive = false;
+    moveFromBin = 0;
+    parkBin = 0;
+    parkingActive = false;
+    verifyState = NOT_VERIFYING;
+    verifyEveryMoves = 0;
+    movesSinceVerify = 0;
 
     // Stop any ongoing movement
     xStepper->forceStop();
@@ -218,36 +702,80 @@ void processSettings(char *message) {
     yStepper->move(1);
 
     settingsInitialized = true; // Settings have been received and processed
-    Serial.println("Settings updated");
-  } else {
-    Serial.println("Error: Not enough settings provided");
+    Link.println("Settings updated");
+
+    loadBinMap();
+    if (binMapActive) {
+      reportBinMap();
+    }
+    return true;
   }
+  Link.println("Error: Not enough settings provided");
+  return false;
 }
 
 
-void processMessage(char *message) {
-  if (!settingsInitialized && message[0] != 's') {
-    Serial.println("Settings not initialized");
-    return;
+// Returns true (and reports why) if a command may not run in the current state
+bool isCommandBlocked(char command) {
+  if (!settingsInitialized && command != 's') {
+    Link.println("Settings not initialized");
+    return true;
   }
 
   // Prevent most commands during active homing (allow 's' maybe?)
   if (currentHomingState != NOT_HOMING && currentHomingState != HOMING_COMPLETE && currentHomingState != HOMING_ERROR) {
-    if (message[0] != 'a') { // Allow trying to home again if in error state
-      Serial.println("Busy: Homing in progress.");
-      return;
+    if (command != 'a') { // Allow trying to home again if in error state
+      Link.println("Busy: Homing in progress.");
+      return true;
     }
   }
 
   // If in error state, only allow 'a' to retry
-  if (currentHomingState == HOMING_ERROR && message[0] != 'a') {
-    Serial.println("Error: Homing failed. Please retry homing ('a').");
-    return;
+  if (currentHomingState == HOMING_ERROR && command != 'a') {
+    Link.println("Error: Homing failed. Please retry homing ('a').");
+    return true;
+  }
+  return false;
+}
+
+uint8_t processMessage(char *message) {
+  // Clock sync ping is answered in every state so the host can keep its offset estimate fresh
+  if (message[0] == 't') {
+    Link.print("T:");
+    Link.print(atol(message + 1));
+    Link.print(",");
+    Link.println(messageReceivedUs);
+    return FRAME_OK;
+  }
+
+  // Baud rate negotiation, format: 'U<BAUD>' then 'u' (see serial_link.h)
+  if (processBaudMessage(message)) {
+    return FRAME_OK;
+  }
+
+  // Log levels, format: 'L<SUBSYSTEM>,<LEVEL>' (see serial_log.h)
+  if (processLogMessage(message)) {
+    return FRAME_OK;
+  }
+
+  // Protocol switch, format: 'P1' -> binary frames (see serial_link.h)
+  if (message[0] == 'P') {
+    if (atoi(message + 1) == 1) {
+      Link.println("Binary mode");
+      binaryMode = true;
+    }
+    return FRAME_OK;
+  }
+
+  if (isCommandBlocked(message[0])) {
+    return FRAME_NAK_BUSY;
   }
 
   switch (message[0]) {
     case 's':
-      processSettings(message);
+      if (!processSettings(message)) {
+        return FRAME_NAK_INVALID;
+      }
       break;
 
     // MOVE SORTER
@@ -258,31 +786,134 @@ void processMessage(char *message) {
       buffer[2] = message[3];
       buffer[3] = '\0';
 
-      int binNum = atoi(buffer);
-      binNum = constrain(binNum, 1, settings.GRID_DIMENSION * settings.GRID_DIMENSION);
-      
-      if (curBin != binNum) {
-        curBin = binNum;
-        moveToBin(binNum);
-        moveCompleteSent = false;
+      queuedMoveActive = false;
+      requestMoveToBin(atoi(buffer));
+      break;
+    }
+
+    // QUEUE MOVE, format: 'Q<ID>,<BIN>,<NOT_BEFORE_US>'
+    case 'Q': {
+      char *binField = strchr(message, ',');
+      char *timeField = binField != NULL ? strchr(binField + 1, ',') : NULL;
+      if (timeField == NULL) {
+        Link.println("Error: Invalid move queue message format");
+        return FRAME_NAK_INVALID;
+      }
+      if (!queueMove((uint16_t)atol(message + 1), (uint16_t)atoi(binField + 1), strtoul(timeField + 1, NULL, 10))) {
+        Link.println("Error: Move queue full");
+        return FRAME_NAK_FULL;
+      }
+      break;
+    }
+
+    // CANCEL QUEUED MOVE, format: 'x<ID>'
+    case 'x': {
+      if (!cancelQueuedMove((uint16_t)atol(message + 1))) {
+        return FRAME_NAK_INVALID; // nothing matched, as for the binary 'x'
+      }
+      break;
+    }
+
+    // BIN MAP ENTRIES, format: 'B<START_BIN>,<PHYSICAL_BIN>,...'
+    case 'B': {
+      int binCount = settings.GRID_DIMENSION * settings.GRID_DIMENSION;
+      int index = atoi(message + 1) - 1;
+      if (binCount > MAX_MAPPED_BINS || index < 0) {
+        Link.println("Error: Invalid bin map message");
+        return FRAME_NAK_INVALID;
+      }
+      if (curBin > 0) {
+        curBin = physicalBin(curBin); // keep the current position while the map changes
+      }
+      binMapActive = false; // moves use the grid order until the new map is committed
+      char *field = strchr(message, ',');
+      while (field != NULL && index < binCount) {
+        binMap[index++] = (uint8_t)atoi(field + 1);
+        field = strchr(field + 1, ',');
+      }
+      break;
+    }
+
+    // BIN MAP COMMIT, format: 'N1' (apply and store) or 'N0' (clear)
+    case 'N': {
+      int binCount = settings.GRID_DIMENSION * settings.GRID_DIMENSION;
+      int curPhysicalBin = curBin > 0 ? physicalBin(curBin) : 0;
+      uint8_t status = FRAME_OK;
+      if (atoi(message + 1) == 0) {
+        binMapActive = false;
+        EEPROM.update(0, 0);
+      } else if (binCount <= MAX_MAPPED_BINS && binMapIsPermutation(binCount)) {
+        saveBinMap();
+        binMapActive = true;
       } else {
-        // Already at the bin, send MC immediately if needed
-        if (moveCompleteSent) {
-          Serial.print("MC: ");
-          Serial.println(curBin);
-        }
+        Link.println("Error: Bin map is not a permutation of the grid");
+        loadBinMap();
+        status = FRAME_NAK_INVALID;
+      }
+      if (curPhysicalBin > 0) {
+        curBin = logicalBin(curPhysicalBin);
       }
+      reportBinMap();
+      return status;
+    }
+
+    // IDLE PARKING, format: 'i<DELAY_MS>,<BIN>'
+    case 'i': {
+      char *binField = strchr(message, ',');
+      if (binField == NULL) {
+        Link.println("Error: Invalid park message format");
+        return FRAME_NAK_INVALID;
+      }
+      parkDelayMs = strtoul(message + 1, NULL, 10);
+      parkBin = constrain(atoi(binField + 1), 0, settings.GRID_DIMENSION * settings.GRID_DIMENSION);
+      break;
+    }
+
+    // POSITION VERIFICATION, format: 'V<EVERY_MOVES>,<IDLE_MS>'
+    case 'V': {
+      char *idleField = strchr(message, ',');
+      if (idleField == NULL) {
+        Link.println("Error: Invalid verify message format");
+        return FRAME_NAK_INVALID;
+      }
+      verifyEveryMoves = (unsigned int)atol(message + 1);
+      verifyIdleMs = strtoul(idleField + 1, NULL, 10);
+      break;
+    }
+
+    // PREDICT MOVE TIME, format: 'd<TO_BIN>' or 'd<FROM_BIN>,<TO_BIN>'
+    case 'd': {
+      int maxBin = settings.GRID_DIMENSION * settings.GRID_DIMENSION;
+      char *toField = strchr(message, ',');
+      int fromBin = toField != NULL ? atoi(message + 1) : (curBin > 0 ? curBin : logicalBin(1));
+      int toBin = atoi(toField != NULL ? toField + 1 : message + 1);
+      if (fromBin < 1 || fromBin > maxBin || toBin < 1 || toBin > maxBin) {
+        Link.println("Error: Invalid bin for move prediction");
+        return FRAME_NAK_INVALID;
+      }
+      Link.print("MP:");
+      Link.print(fromBin);
+      Link.print(",");
+      Link.print(toBin);
+      Link.print(",");
+      Link.println(predictMoveTimeUs(fromBin, toBin));
       break;
     }
 
     // MOVE TO CENTER
     case 'h': { 
-      int centerBin = ((settings.GRID_DIMENSION * settings.GRID_DIMENSION) + 1) / 2;
+      int centerBin = logicalBin(((settings.GRID_DIMENSION * settings.GRID_DIMENSION) + 1) / 2);
       if (settings.ROW_MAJOR_ORDER) {
         // Adjust center bin for row-major order if necessary
       }
-      Serial.print("centerBin: ");
-      Serial.println(centerBin);
+      LOG_INFO(LOG_SORTER, "centerBin: %d", centerBin);
+      bool interrupted = abortVerification() || parkingActive;
+      movesSinceVerify++;
+      queuedMoveActive = false;
+      moveFromBin = interrupted ? 0 : (curBin > 0 ? curBin : logicalBin(1));
+      parkingActive = false;
+      moveStartUs = micros();
+      curBin = centerBin; // keep the timing reports of later moves on the right start bin
       moveToBin(centerBin);
       moveCompleteSent = false;
       break;
@@ -291,106 +922,292 @@ void processMessage(char *message) {
     // HOMING PROCEDURE
     case 'a': {
       if (currentHomingState != NOT_HOMING && currentHomingState != HOMING_COMPLETE && currentHomingState != HOMING_ERROR) {
-        Serial.println("Error: Homing already in progress.");
-        break;
+        Link.println("Error: Homing already in progress.");
+        return FRAME_NAK_BUSY;
       }
       if (!settingsInitialized) {
-        Serial.println("Error: Settings not initialized. Cannot home.");
-        break;
+        Link.println("Error: Settings not initialized. Cannot home.");
+        return FRAME_NAK_BUSY;
+      }
+      if (abortVerification()) {
+        xStepper->stopMove();
+        yStepper->stopMove();
       }
       if (xStepper->isRunning() || yStepper->isRunning()) {
-        Serial.println("Error: Steppers busy. Cannot start homing.");
-        break;
+        Link.println("Error: Steppers busy. Cannot start homing.");
+        return FRAME_NAK_BUSY;
       }
 
-      Serial.println("Homing sequence initiated...");
+      LOG_INFO(LOG_SORTER, "Homing sequence initiated...");
+      movesSinceVerify = 0; // homing is a full position check
+      moveQueueCount = 0; // queued moves were planned from the old position
+      queuedMoveActive = false;
+      moveFromBin = 0;
+      parkingActive = false;
       currentHomingState = HOMING_START;
       break;
     }
 
     default:
-      Serial.println("No matching serial communication");
+      LOG_WARN(LOG_SYSTEM, "No matching serial communication");
+      return FRAME_NAK_INVALID;
+  }
+  return FRAME_OK;
+}
+
+// --- Binary Frame Handling (see serial_link.h) ---
+void processFrame(uint8_t opcode, uint8_t seq, uint8_t *payload, uint8_t payloadLength) {
+  messageReceivedUs = micros();
+
+  switch (opcode) {
+    case 't': { // clock sync ping, answered with a pong frame instead of an ACK
+      if (payloadLength != 4) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      uint8_t pong[8];
+      memcpy(pong, payload, 4);
+      frameWriteU32(&pong[4], messageReceivedUs);
+      sendFrame('T', 0, pong, sizeof(pong));
+      return;
+    }
+
+    case 'P': {
+      if (payloadLength != 1) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      sendAck(seq, opcode);
+      if (payload[0] == 0) {
+        binaryMode = false;
+        Link.println("ASCII mode");
+      }
+      return;
+    }
+
+    case 'm': {
+      if (payloadLength != 2) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      if (isCommandBlocked(opcode)) {
+        sendNak(seq, opcode, FRAME_NAK_BUSY);
+        return;
+      }
+      sendAck(seq, opcode);
+      queuedMoveActive = false;
+      requestMoveToBin(frameReadU16(payload));
+      return;
+    }
+
+    case 'Q': {
+      if (payloadLength != 8) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      if (isCommandBlocked(opcode)) {
+        sendNak(seq, opcode, FRAME_NAK_BUSY);
+        return;
+      }
+      if (!queueMove(frameReadU16(payload), frameReadU16(&payload[2]), frameReadU32(&payload[4]))) {
+        sendNak(seq, opcode, FRAME_NAK_FULL);
+        return;
+      }
+      sendAck(seq, opcode);
+      return;
+    }
+
+    case 'x': {
+      if (payloadLength != 2 || !cancelQueuedMove(frameReadU16(payload))) {
+        sendNak(seq, opcode, FRAME_NAK_INVALID);
+        return;
+      }
+      sendAck(seq, opcode);
+      return;
+    }
+
+    default:
+      processTextFrame(opcode, seq, payload, payloadLength);
+      return;
+  }
+}
+
+// Time-based endstop debounce, the stepper position is latched at every closing edge
+void updateEndstop(AxisHoming &axis) {
+  bool reading = digitalRead(axis.stopPin) == LOW;
+  if (reading != axis.rawPressed) {
+    axis.rawPressed = reading;
+    axis.rawChangedMillis = millis();
+    if (reading) {
+      axis.edgePosition = axis.stepper->getCurrentPosition();
+    }
+  }
+  if (axis.pressed != axis.rawPressed && millis() - axis.rawChangedMillis >= ENDSTOP_DEBOUNCE_MS) {
+    axis.pressed = axis.rawPressed;
+  }
+}
+
+void setAxisPhase(AxisHoming &axis, AxisHomingPhase phase) {
+  axis.phase = phase;
+  axis.phaseStartMillis = millis();
+  switch (phase) {
+    case AXIS_POSITION:
+      axis.stepper->moveTo(VERIFY_START_POSITION);
+      break;
+    case AXIS_FAST_APPROACH:
+      axis.stepper->setSpeedInUs(settings.HOMING_FAST_SPEED);
+      axis.stepper->runBackward();
+      break;
+    case AXIS_RELEASE:
+      axis.stepper->setSpeedInUs(settings.HOMING_SPEED);
+      axis.stepper->runForward();
+      break;
+    case AXIS_BACKOFF:
+      axis.stepper->move(HOMING_BACKOFF_STEPS);
+      break;
+    case AXIS_SLOW_APPROACH:
+      axis.stepper->setSpeedInUs(settings.HOMING_SPEED);
+      axis.stepper->runBackward();
+      break;
+    case AXIS_HOMED:
       break;
   }
 }
 
-// Helper function to check endstop with optional debounce
-bool checkEndstop(int pin) {
-  if (digitalRead(pin) == LOW) {
-    // Simple debounce - wait 5ms and check again
-    delay(5);
-    return digitalRead(pin) == LOW;
+void startAxisHoming(AxisHoming &axis, FastAccelStepper *stepper, AxisHomingPhase firstPhase) {
+  axis.stepper = stepper;
+  axis.rawPressed = digitalRead(axis.stopPin) == LOW;
+  axis.pressed = axis.rawPressed;
+  axis.rawChangedMillis = millis();
+  axis.drift = 0;
+  if (axis.pressed) {
+    setAxisPhase(axis, AXIS_RELEASE); // resting on the switch, its trigger point is only found by approaching it
+  } else {
+    setAxisPhase(axis, firstPhase);
   }
-  return false;
+}
+
+// Advance the homing of one axis. Returns false (and reports why) if the axis failed to home.
+bool updateAxisHoming(AxisHoming &axis) {
+  if (axis.phase == AXIS_HOMED) {
+    return true;
+  }
+  updateEndstop(axis);
+
+  switch (axis.phase) {
+    case AXIS_POSITION:
+      if (axis.pressed) {
+        axis.stepper->forceStop(); // the endstop is closer than the step count says
+        setAxisPhase(axis, AXIS_RELEASE);
+        return true;
+      }
+      if (!axis.stepper->isRunning()) {
+        setAxisPhase(axis, AXIS_SLOW_APPROACH);
+        return true;
+      }
+      break;
+
+    case AXIS_FAST_APPROACH:
+      if (axis.pressed) {
+        LOG_INFO(LOG_SORTER, "%s endstop hit, re-approaching slowly.", axis.name);
+        axis.stepper->forceStop();
+        setAxisPhase(axis, AXIS_RELEASE);
+        return true;
+      }
+      break;
+
+    case AXIS_RELEASE:
+      if (!axis.pressed) {
+        axis.stepper->forceStop();
+        setAxisPhase(axis, AXIS_BACKOFF);
+        return true;
+      }
+      break;
+
+    case AXIS_BACKOFF:
+      if (!axis.stepper->isRunning()) {
+        if (axis.pressed) {
+          Link.print("Error: Homing ");
+          Link.print(axis.name);
+          Link.println(" endstop stuck!");
+          return false;
+        }
+        setAxisPhase(axis, AXIS_SLOW_APPROACH);
+        return true;
+      }
+      break;
+
+    case AXIS_SLOW_APPROACH:
+      if (axis.pressed) {
+        LOG_INFO(LOG_SORTER, "%s endstop hit.", axis.name);
+        axis.stepper->forceStop();
+        // Zero sits HOMING_BACKOFF_STEPS behind the trigger point, so calibrated offsets stay valid
+        axis.drift = axis.edgePosition - HOMING_BACKOFF_STEPS;
+        axis.stepper->setCurrentPosition(HOMING_BACKOFF_STEPS + (axis.stepper->getCurrentPosition() - axis.edgePosition));
+        axis.phase = AXIS_HOMED;
+        return true;
+      }
+      break;
+
+    case AXIS_HOMED:
+      break;
+  }
+
+  if (millis() - axis.phaseStartMillis > HOMING_TIMEOUT_MS) {
+    Link.print("Error: Homing ");
+    Link.print(axis.name);
+    Link.println(" timed out!");
+    return false;
+  }
+  return true;
 }
 
 void handleHoming() {
   switch (currentHomingState) {
-    case HOMING_START:
-      // Start Y axis first
-      Serial.println("Homing Y axis...");
-      yStepper->setSpeedInUs(settings.HOMING_SPEED);
-      yStepper->runBackward();
+    case HOMING_START: {
+      // Both axes home at the same time, each with its own phases and timeouts
+      LOG_INFO(LOG_SORTER, "Homing X and Y axes...");
       homingStartMillis = millis();
-      currentHomingState = HOMING_Y_BACKWARD;
+      AxisHomingPhase firstPhase = settings.HOMING_FAST_SPEED > 0 ? AXIS_FAST_APPROACH : AXIS_SLOW_APPROACH;
+      startAxisHoming(xHoming, xStepper, firstPhase);
+      startAxisHoming(yHoming, yStepper, firstPhase);
+      currentHomingState = HOMING_AXES;
       break;
+    }
 
-    case HOMING_Y_BACKWARD:
-      if (checkEndstop(Y_STOP_PIN)) {
-        Serial.println("Y endstop hit.");
-        yStepper->forceStop();
-        yStepper->move(-HOMING_BACKOFF_STEPS, true); // Back off slowly
-        yStepper->setCurrentPosition(0);
-
-        // Now start X axis homing
-        Serial.println("Homing X axis...");
-        xStepper->setSpeedInUs(settings.HOMING_SPEED);
-        xStepper->runBackward();
-        homingStartMillis = millis();
-        currentHomingState = HOMING_X_BACKWARD;
-
-      } else if (millis() - homingStartMillis > HOMING_TIMEOUT_MS) {
-        Serial.println("Error: Homing Y timed out!");
+    case HOMING_AXES: {
+      bool xOk = updateAxisHoming(xHoming);
+      bool yOk = updateAxisHoming(yHoming);
+      if (!xOk || !yOk) {
         xStepper->forceStop();
         yStepper->forceStop();
         currentHomingState = HOMING_ERROR;
+        break;
+      }
+      if (xHoming.phase != AXIS_HOMED || yHoming.phase != AXIS_HOMED) {
+        break;
       }
-      break;
 
-    case HOMING_X_BACKWARD:
-      if (checkEndstop(X_STOP_PIN)) {
-        Serial.println("X endstop hit.");
-        xStepper->forceStop();
-        xStepper->move(-HOMING_BACKOFF_STEPS, true); // Back off slowly
-        xStepper->setCurrentPosition(0);
-
-        // Both axes homed, now move to offsets (non-blocking)
-        Serial.println("Moving to offsets...");
-        xStepper->setSpeedInUs(settings.SPEED);
-        yStepper->setSpeedInUs(settings.SPEED);
-
-        bool xMoveStarted = (xStepper->moveTo(settings.X_OFFSET) == MOVE_OK);
-        bool yMoveStarted = (yStepper->moveTo(settings.Y_OFFSET) == MOVE_OK);
-
-        if (xMoveStarted || yMoveStarted) {
-          currentHomingState = HOMING_WAIT_FOR_OFFSET;
-        } else {
-          currentHomingState = HOMING_COMPLETE;
-          Serial.println("Homing complete (already at offsets).");
-          curBin = 0;
-        }
+      // Both axes homed, now move to offsets (non-blocking)
+      LOG_INFO(LOG_SORTER, "Moving to offsets...");
+      applyAxisLimits(0, 0);
 
-      } else if (millis() - homingStartMillis > HOMING_TIMEOUT_MS) {
-        Serial.println("Error: Homing X timed out!");
-        xStepper->forceStop();
-        yStepper->forceStop();
-        currentHomingState = HOMING_ERROR;
+      bool xMoveStarted = (xStepper->moveTo(settings.X_OFFSET) == MOVE_OK);
+      bool yMoveStarted = (yStepper->moveTo(settings.Y_OFFSET) == MOVE_OK);
+
+      if (xMoveStarted || yMoveStarted) {
+        currentHomingState = HOMING_WAIT_FOR_OFFSET;
+      } else {
+        currentHomingState = HOMING_COMPLETE;
+        LOG_INFO(LOG_SORTER, "Homing complete (already at offsets).");
+        curBin = 0;
       }
       break;
+    }
 
     case HOMING_WAIT_FOR_OFFSET:
       if (!xStepper->isRunning() && !yStepper->isRunning()) {
-        Serial.println("Homing complete.");
+        LOG_INFO(LOG_SORTER, "Homing complete.");
         currentHomingState = HOMING_COMPLETE;
         curBin = 0;
       }
@@ -410,6 +1227,118 @@ void handleHoming() {
   }
 }
 
+// Start the head of the move queue once the sorter is idle and its start time has come.
+// A position check in progress gives way to it.
+void startNextQueuedMove() {
+  if (moveQueueCount == 0 || !moveCompleteSent) {
+    return;
+  }
+  if (verifyState == NOT_VERIFYING && (xStepper->isRunning() || yStepper->isRunning())) {
+    return;
+  }
+  if ((long)(micros() - moveQueue[0].notBeforeUs) < 0) {
+    return;
+  }
+  QueuedMove next = moveQueue[0];
+  moveQueueCount--;
+  for (uint8_t i = 0; i < moveQueueCount; i++) {
+    moveQueue[i] = moveQueue[i + 1];
+  }
+  queuedMoveActive = true;
+  activeMoveId = next.id;
+  LOG_DEBUG(LOG_SORTER, "Queued move %u -> bin %u", next.id, next.bin);
+  if (verifyState == NOT_VERIFYING && curBin == constrain((int)next.bin, 1, settings.GRID_DIMENSION * settings.GRID_DIMENSION)) {
+    sendMoveComplete(curBin); // already there
+    return;
+  }
+  requestMoveToBin(next.bin);
+}
+
+// Run a position check once one is due and the sorter is idle, see 'V' above
+void verifyWhenIdle() {
+  switch (verifyState) {
+    case NOT_VERIFYING:
+      if (verifyEveryMoves == 0 || movesSinceVerify < verifyEveryMoves) {
+        return;
+      }
+      if (parkingActive || !moveCompleteSent || moveQueueCount > 0 || xStepper->isRunning() || yStepper->isRunning()) {
+        return;
+      }
+      if (millis() - idleSinceMs < verifyIdleMs) {
+        return;
+      }
+      LOG_INFO(LOG_SORTER, "Checking position...");
+      applyAxisLimits(0, 0);
+      startAxisHoming(xHoming, xStepper, AXIS_POSITION);
+      startAxisHoming(yHoming, yStepper, AXIS_POSITION);
+      verifyState = VERIFY_AXES;
+      break;
+
+    case VERIFY_AXES: {
+      bool xOk = updateAxisHoming(xHoming);
+      bool yOk = updateAxisHoming(yHoming);
+      if (!xOk || !yOk) {
+        xStepper->forceStop();
+        yStepper->forceStop();
+        verifyState = NOT_VERIFYING;
+        currentHomingState = HOMING_ERROR; // the position is unknown until the sorter is homed again
+        return;
+      }
+      if (xHoming.phase != AXIS_HOMED || yHoming.phase != AXIS_HOMED) {
+        return;
+      }
+      movesSinceVerify = 0; // a cancelled check runs again at the next idle period
+      Link.print("VD:");
+      Link.print(xHoming.drift);
+      Link.print(",");
+      Link.println(yHoming.drift);
+
+      // After homing (curBin 0) the sorter rests at the offsets
+      if (curBin > 0) {
+        moveToBin(curBin);
+      } else {
+        applyAxisLimits(0, 0);
+        xStepper->moveTo(settings.X_OFFSET);
+        yStepper->moveTo(settings.Y_OFFSET);
+      }
+      verifyState = VERIFY_RETURN;
+      break;
+    }
+
+    case VERIFY_RETURN:
+      if (!xStepper->isRunning() && !yStepper->isRunning()) {
+        verifyState = NOT_VERIFYING;
+        idleSinceMs = millis(); // parking waits for its delay again
+      }
+      break;
+  }
+}
+
+// Move to the park bin once the sorter has been idle long enough. A queued move that comes due while
+// parking waits until the sorter has stopped, a direct move takes over right away.
+void parkWhenIdle() {
+  if (parkingActive) {
+    if (!xStepper->isRunning() && !yStepper->isRunning()) {
+      parkingActive = false;
+    }
+    return;
+  }
+  if (parkBin == 0 || curBin == parkBin || !moveCompleteSent || xStepper->isRunning() || yStepper->isRunning()) {
+    return;
+  }
+  if (millis() - idleSinceMs < parkDelayMs) {
+    return;
+  }
+  if (moveQueueCount > 0 && (long)(micros() - moveQueue[0].notBeforeUs) >= 0) {
+    return; // the next move is due now
+  }
+  Link.print("PK:");
+  Link.println(parkBin);
+  curBin = parkBin;
+  parkingActive = true;
+  moveToBin(parkBin);
+}
+
 // ___________________________ MAIN LOOP ___________________________
 #define START_MARKER '<'
 #define END_MARKER '>'
@@ -419,15 +1348,24 @@ void loop() {
   static unsigned int message_pos = 0;
   static bool capturingMessage = false;
 
+  // Fall back to the default baud rate if the host never confirmed a switch
+  serviceBaudNegotiation();
+
   // Check to see if anything is available in the serial receive buffer
   while (Serial.available() > 0) {
     char inByte = Serial.read();
 
+    if (binaryMode) {
+      frameParserFeed((uint8_t)inByte);
+      continue;
+    }
+
     if(inByte == START_MARKER) {
       capturingMessage = true;
       message_pos = 0;
     }
     else if (inByte == END_MARKER) {
+      messageReceivedUs = micros();
       capturingMessage = false;
       message[message_pos] = '\0';  // Null terminate the string
       processMessage(message);
@@ -437,7 +1375,7 @@ void loop() {
       message_pos++;
       if (message_pos >= MAX_MESSAGE_LENGTH) {
         capturingMessage = false;
-        Serial.println("Error: Message too long");
+        Link.println("Error: Message too long");
       }
     }
   }
@@ -448,11 +1386,20 @@ void loop() {
   // Check if a non-homing move is complete and send a message if it is
   // Make sure not to send MC during homing offset moves
   if (currentHomingState == NOT_HOMING || currentHomingState == HOMING_COMPLETE) {
+    trackAxisMoveTimes();
     if (!moveCompleteSent && !xStepper->isRunning() && !yStepper->isRunning()) {
-      Serial.print("MC: "); // Send message over serial
-      Serial.println(curBin);
+      sendMoveTime(curBin);
+      sendMoveComplete(curBin);
       moveCompleteSent = true; // Set the flag to indicate that the message has been sent
     }
+    verifyWhenIdle();
+    if (verifyState == NOT_VERIFYING) {
+      parkWhenIdle();
+    }
+    startNextQueuedMove();
   }
+
+  // Hand queued serial output to the hardware buffer without blocking
+  serialTxPump();
 }
 
@@ -226,6 +226,107 @@ const SettingsForm = () => {
                 </FormItem>
               )}
             />
+            <FormField
+              control={form.control}
+              name="conveyorRampRPMPerSecond"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Conveyor Speed Ramp (RPM/s, 0 = step)</FormLabel>
+                  <FormControl>
+                    <Input type="number" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="conveyorOdometryIntervalMs"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Conveyor Odometry Interval (ms, 0 = off)</FormLabel>
+                  <FormControl>
+                    <Input type="number" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <HoverCard>
+              <HoverCardTrigger asChild>
+                <div>
+                  <FormField
+                    control={form.control}
+                    name="positionTriggeredJets"
+                    render={({ field }) => (
+                      <FormItem className="flex flex-row items-center justify-start gap-x-2">
+                        <FormLabel>Position-Triggered Jets</FormLabel>
+                        <FormControl>
+                          <Input
+                            type="checkbox"
+                            className="h-4 w-4"
+                            checked={field.value}
+                            onChange={(e) => field.onChange(e.target.checked)}
+                          />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+                </div>
+              </HoverCardTrigger>
+              <HoverCardContent>
+                If checked, jets fire when the conveyor encoder reaches the position of the part instead of at a
+                predicted time, so belt speed changes no longer shift ejection. Needs odometry streaming; falls back to
+                timed fires while no odometry is received.
+              </HoverCardContent>
+            </HoverCard>
+            <HoverCard>
+              <HoverCardTrigger asChild>
+                <div>
+                  <FormField
+                    control={form.control}
+                    name="sorterParkDelayMs"
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>Sorter Park Delay (ms, 0 = off)</FormLabel>
+                        <FormControl>
+                          <Input type="number" {...field} />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+                </div>
+              </HoverCardTrigger>
+              <HoverCardContent>
+                How long a sorter waits after its last move before parking at the bin with the shortest expected
+                travel to the next part. Must be longer than a part takes to fall through the funnel.
+              </HoverCardContent>
+            </HoverCard>
+            <HoverCard>
+              <HoverCardTrigger asChild>
+                <div>
+                  <FormField
+                    control={form.control}
+                    name="sorterVerifyEveryMoves"
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>Sorter Position Check (moves, 0 = off)</FormLabel>
+                        <FormControl>
+                          <Input type="number" {...field} />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+                </div>
+              </HoverCardTrigger>
+              <HoverCardContent>
+                After this many moves an idle sorter re-approaches its endstops and corrects any lost steps, so it does
+                not need to be re-homed. Runs once the sorter has been idle for the park delay (at least 1 s).
+              </HoverCardContent>
+            </HoverCard>
           </CardContent>
         </Card>
 
@@ -244,6 +345,75 @@ const SettingsForm = () => {
               name="hopperFeederSerialPort"
               label="Hopper Feeder Serial Port"
             />
+            <FormField
+              control={form.control}
+              name="maxSerialBaudRate"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Max Serial Baud Rate</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <HoverCard>
+              <HoverCardTrigger asChild>
+                <div>
+                  <FormField
+                    control={form.control}
+                    name="binarySerialProtocol"
+                    render={({ field }) => (
+                      <FormItem className="flex flex-row items-center justify-start gap-x-2">
+                        <FormLabel>Binary Serial Protocol</FormLabel>
+                        <FormControl>
+                          <Input
+                            type="checkbox"
+                            className="h-4 w-4"
+                            checked={field.value}
+                            onChange={(e) => field.onChange(e.target.checked)}
+                          />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+                </div>
+              </HoverCardTrigger>
+              <HoverCardContent>
+                If checked, devices switch to compact CRC-checked binary frames with acknowledgments after their settings
+                are applied. Takes effect when a device reconnects.
+              </HoverCardContent>
+            </HoverCard>
+            <HoverCard>
+              <HoverCardTrigger asChild>
+                <div>
+                  <FormField
+                    control={form.control}
+                    name="firmwareDebugLogging"
+                    render={({ field }) => (
+                      <FormItem className="flex flex-row items-center justify-start gap-x-2">
+                        <FormLabel>Firmware Debug Logging</FormLabel>
+                        <FormControl>
+                          <Input
+                            type="checkbox"
+                            className="h-4 w-4"
+                            checked={field.value}
+                            onChange={(e) => field.onChange(e.target.checked)}
+                          />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+                </div>
+              </HoverCardTrigger>
+              <HoverCardContent>
+                If checked, all devices send their debug diagnostics. Diagnostics are buffered and dropped when the serial
+                link is busy, so they never delay jet firing or move completion messages.
+              </HoverCardContent>
+            </HoverCard>
           </CardContent>
         </Card>
 
@@ -318,6 +488,30 @@ const SettingsForm = () => {
                 </FormItem>
               )}
             />
+            <HoverCard>
+              <HoverCardTrigger asChild>
+                <div>
+                  <FormField
+                    control={form.control}
+                    name="feederTargetPartsPerMinute"
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>Feeder Target Rate (parts/min, 0 = off)</FormLabel>
+                        <FormControl>
+                          <Input className="w-full" {...field} />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+                </div>
+              </HoverCardTrigger>
+              <HoverCardContent>
+                If set, the feeder measures the time between parts at its sensor and adjusts its pause time and
+                vibration speed to deliver this many evenly spaced parts per minute.
+                The pause time setting is then only the starting point.
+              </HoverCardContent>
+            </HoverCard>
             <FormField
               control={form.control}
               name="hopperCycleInterval"
@@ -331,6 +525,193 @@ const SettingsForm = () => {
                 </FormItem>
               )}
             />
+            <HoverCard>
+              <HoverCardTrigger asChild>
+                <div>
+                  <FormField
+                    control={form.control}
+                    name="hopperCyclePolicy"
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>Hopper Cycle Policy</FormLabel>
+                        <Select value={field.value} onValueChange={field.onChange}>
+                          <FormControl>
+                            <SelectTrigger>
+                              <SelectValue placeholder="Select a hopper cycle policy" />
+                            </SelectTrigger>
+                          </FormControl>
+                          <SelectContent>
+                            <SelectItem value="vibrationTime">Feeder vibration time</SelectItem>
+                            <SelectItem value="starvation">No part at the feeder exit</SelectItem>
+                            <SelectItem value="fillLevel">Fill level sensor</SelectItem>
+                          </SelectContent>
+                        </Select>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+                </div>
+              </HoverCardTrigger>
+              <HoverCardContent>
+                Feeder vibration time cycles the hopper every Hopper Cycle Interval ms of feeder vibration. No part at
+                the feeder exit cycles it when no part arrived for the starvation time. Fill level sensor cycles it when
+                the fill sensor reads farther than the threshold, and falls back to the vibration time without a
+                reading. Each cycle reports its trigger, duration, part count and fill reading as an HC: line.
+              </HoverCardContent>
+            </HoverCard>
+            <FormField
+              control={form.control}
+              name="hopperStarvationMs"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Starvation Time (ms)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="hopperFillThreshold"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Fill Threshold (sensor distance)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="hopperMinCycleIntervalMs"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Min Cycle Interval (ms)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="hopperStrokeSteps"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Stroke (steps)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <HoverCard>
+              <HoverCardTrigger asChild>
+                <div>
+                  <FormField
+                    control={form.control}
+                    name="hopperLoadedStrokeSteps"
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>Hopper Loaded Stroke (steps, 0 = full)</FormLabel>
+                        <FormControl>
+                          <Input className="w-full" {...field} />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+                </div>
+              </HoverCardTrigger>
+              <HoverCardContent>
+                Stroke of hopper cycles that start while a part still waits at the feeder exit. A partial stroke
+                releases fewer parts when the feeder is already loaded. Only full strokes reach the bottom switch.
+              </HoverCardContent>
+            </HoverCard>
+            <FormField
+              control={form.control}
+              name="hopperDownSpeedUs"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Down Speed (us/step)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="hopperDownAcceleration"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Down Acceleration (steps/s²)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="hopperUpSpeedUs"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Up Speed (us/step)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="hopperUpAcceleration"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Up Acceleration (steps/s²)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="hopperBottomDwellMs"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Bottom Dwell (ms)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
+            <FormField
+              control={form.control}
+              name="hopperFillSensorAddress"
+              render={({ field }) => (
+                <FormItem>
+                  <FormLabel>Hopper Fill Sensor I2C Address (0 = none)</FormLabel>
+                  <FormControl>
+                    <Input className="w-full" {...field} />
+                  </FormControl>
+                  <FormMessage />
+                </FormItem>
+              )}
+            />
           </CardContent>
         </Card>
 
@@ -535,7 +916,7 @@ const SettingsForm = () => {
                     name={`sorters.${index}.acceleration`}
                     render={({ field }) => (
                       <FormItem>
-                        <FormLabel>Acceleration</FormLabel>
+                        <FormLabel>X Acceleration</FormLabel>
                         <FormControl>
                           <Input {...field} />
                         </FormControl>
@@ -558,12 +939,26 @@ const SettingsForm = () => {
                     )}
                   />
 
+                  <FormField
+                    control={form.control}
+                    name={`sorters.${index}.homingFastSpeed`}
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>Homing Fast Speed</FormLabel>
+                        <FormControl>
+                          <Input {...field} />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+
                   <FormField
                     control={form.control}
                     name={`sorters.${index}.speed`}
                     render={({ field }) => (
                       <FormItem>
-                        <FormLabel>Speed</FormLabel>
+                        <FormLabel>X Speed</FormLabel>
                         <FormControl>
                           <Input {...field} />
                         </FormControl>
@@ -571,6 +966,67 @@ const SettingsForm = () => {
                       </FormItem>
                     )}
                   />
+
+                  <FormField
+                    control={form.control}
+                    name={`sorters.${index}.yAcceleration`}
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>Y Acceleration (0 = X)</FormLabel>
+                        <FormControl>
+                          <Input {...field} />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+
+                  <FormField
+                    control={form.control}
+                    name={`sorters.${index}.ySpeed`}
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>Y Speed (0 = X)</FormLabel>
+                        <FormControl>
+                          <Input {...field} />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+
+                  <FormField
+                    control={form.control}
+                    name={`sorters.${index}.sCurveSteps`}
+                    render={({ field }) => (
+                      <FormItem>
+                        <FormLabel>S-Curve Steps (0 = off)</FormLabel>
+                        <FormControl>
+                          <Input {...field} />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
+
+                  <FormField
+                    control={form.control}
+                    name={`sorters.${index}.synchronizedMoves`}
+                    render={({ field }) => (
+                      <FormItem className="flex flex-row items-center space-x-2">
+                        <FormLabel>Synchronized Moves</FormLabel>
+                        <FormControl>
+                          <Input
+                            type="checkbox"
+                            className="h-4 w-4"
+                            checked={field.value}
+                            onChange={(e) => field.onChange(e.target.checked)}
+                          />
+                        </FormControl>
+                        <FormMessage />
+                      </FormItem>
+                    )}
+                  />
                 </div>
               ))}
             </div>
@@ -0,0 +1,28 @@
+// components/buttons/ConveyorAutotuneButton.tsx
+
+'use client';
+
+import React from 'react';
+import { Button } from '@/components/ui/button';
+import serviceManager from '@/lib/services/ServiceManager';
+import { ServiceName } from '@/lib/services/Service.interface';
+import { AllEvents } from '@/types/socketMessage.type';
+
+// Runs the conveyor speed controller autotune. The motor sweeps its speed range and oscillates for
+// about half a minute, then stops; the measured gains and feedforward table are saved to the settings.
+const ConveyorAutotuneButton = () => {
+  const handleClick = async () => {
+    const socket = serviceManager.getService(ServiceName.SOCKET);
+    if (!socket) return;
+    socket.emit(AllEvents.AUTOTUNE_CONVEYOR, undefined);
+    console.log('Conveyor autotune button clicked');
+  };
+
+  return (
+    <Button type="button" onClick={handleClick}>
+      Autotune Conveyor
+    </Button>
+  );
+};
+
+export default ConveyorAutotuneButton;
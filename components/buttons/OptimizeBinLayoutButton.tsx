@@ -0,0 +1,30 @@
+// components/buttons/OptimizeBinLayoutButton.tsx
+
+'use client';
+
+import React from 'react';
+import { Button } from '@/components/ui/button';
+import serviceManager from '@/lib/services/ServiceManager';
+import { ServiceName } from '@/lib/services/Service.interface';
+import { AllEvents } from '@/types/socketMessage.type';
+import { useSettings } from '@/components/hooks/useSettings';
+
+// Rearranges each sorter's bins from the parts sorted since the server started, so frequent and
+// consecutive bins end up close together. The new layout is saved to the settings and sent to the sorters.
+const OptimizeBinLayoutButton = () => {
+  const { settings } = useSettings();
+
+  const handleClick = async () => {
+    const socket = serviceManager.getService(ServiceName.SOCKET);
+    if (!socket) return;
+    socket.emit(AllEvents.OPTIMIZE_BIN_LAYOUT, undefined);
+  };
+
+  return (
+    <Button type="button" onClick={handleClick} disabled={!settings}>
+      Optimize Bin Layout
+    </Button>
+  );
+};
+
+export default OptimizeBinLayoutButton;
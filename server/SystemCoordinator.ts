@@ -8,6 +8,7 @@ import { SpeedManager } from './components/SpeedManager';
 import { SortPartDto } from '../types/sortPart.dto';
 import { Part } from '../types/part.type';
 import { DeviceName } from '../types/deviceName.type';
+import { ArduinoCommands } from '../types/arduinoCommands.type';
 
 export const FALL_TIME_SHORTEST = 1200;
 export const FALL_TIME_LONGEST = 2000;
@@ -30,6 +31,8 @@ export class SystemCoordinator {
       onFireJet: this.handleFireJet.bind(this),
       onListSerialPorts: this.handleListSerialPorts.bind(this),
       onResetSortProcess: this.handleResetSortProcess.bind(this),
+      onAutotuneConveyor: this.handleAutotuneConveyor.bind(this),
+      onOptimizeBinLayout: this.handleOptimizeBinLayout.bind(this),
       onUpdateFeederSettings: this.handleUpdateFeederSettings.bind(this),
     });
 
@@ -181,10 +184,17 @@ export class SystemCoordinator {
     const jetTime = this.conveyorManager.findTimeAfterDistance(initialTime, distanceToJet);
     // move time
     const sorterPreviousPart = this.conveyorManager.findPreviousSorterPart(sorter);
-    const travelTimeFromPreviousBin = this.sorterManager.getTravelTimeBetweenBins({
+    const travelTimeFromPreviousBin = this.sorterManager.getTravelTimeForPart({
       sorter: sorter,
-      fromBin: sorterPreviousPart?.bin,
       toBin: bin,
+      moveEnd: jetTime + FALL_TIME_SHORTEST,
+      previous: sorterPreviousPart
+        ? {
+            bin: sorterPreviousPart.bin,
+            moveTime: sorterPreviousPart.moveTime,
+            moveEnd: sorterPreviousPart.jetTime + FALL_TIME_SHORTEST,
+          }
+        : undefined,
     });
     const moveTime = jetTime + FALL_TIME_SHORTEST - travelTimeFromPreviousBin;
     const moveFinishedTime = jetTime + FALL_TIME_LONGEST;
@@ -251,6 +261,19 @@ export class SystemCoordinator {
     this.conveyorManager.reinitialize();
   }
 
+  private handleAutotuneConveyor(): void {
+    // The conveyor reports the result with 'AT:', which DeviceManager persists to the settings
+    this.deviceManager.sendCommand(DeviceName.CONVEYOR_JETS, ArduinoCommands.AUTOTUNE, 1);
+  }
+
+  private async handleOptimizeBinLayout(): Promise<void> {
+    try {
+      await this.sorterManager.optimizeBinLayouts();
+    } catch (error) {
+      console.error('\x1b[33mError optimizing bin layout:\x1b[0m', error);
+    }
+  }
+
   private handleUpdateFeederSettings(data: {
     vibrationSpeed: number;
     stopDelay: number;
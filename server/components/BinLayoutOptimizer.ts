@@ -0,0 +1,96 @@
+export interface BinLayoutInput {
+  gridDimension: number;
+  rowMajorOrder: boolean;
+  visits: number[]; // parts sent to logical bin i + 1
+  transitions: number[][]; // consecutive parts from logical bin i + 1 to logical bin j + 1
+  travelTime: (dx: number, dy: number) => number; // ms for a move of dx, dy grid cells
+}
+
+// Weight of the distance to the center bin (where the sorter homes and waits) against the bin-to-bin travel
+const CENTER_WEIGHT = 0.5;
+const MAX_SWAP_PASSES = 20;
+
+// Grid cell of a physical bin, numbered like moveToBin() in sorter.cpp
+export const binGridPosition = (
+  physicalBin: number,
+  gridDimension: number,
+  rowMajorOrder: boolean,
+): { x: number; y: number } => {
+  const major = Math.floor((physicalBin - 1) / gridDimension);
+  const minor = (physicalBin - 1) % gridDimension;
+  return rowMajorOrder ? { x: minor, y: major } : { x: major, y: minor };
+};
+
+// True if the layout assigns every physical bin of the grid to exactly one logical bin
+export const isValidBinLayout = (layout: number[], gridDimension: number): boolean => {
+  const binCount = gridDimension * gridDimension;
+  if (layout.length !== binCount) return false;
+  const seen = new Set(layout);
+  return seen.size === binCount && layout.every((bin) => Number.isInteger(bin) && bin >= 1 && bin <= binCount);
+};
+
+/**
+ * Finds a logical-to-physical bin layout that keeps the expected sorter travel low.
+ *
+ * The cost of a layout is the average travel time between consecutive parts, weighted by how often each
+ * pair of bins follows each other, plus the average travel time from the center bin. The most visited bins are
+ * first placed around the center, then pairs of bins are swapped as long as that lowers the cost.
+ * Returns the physical bin of each logical bin (index 0 = logical bin 1).
+ */
+export const optimizeBinLayout = ({
+  gridDimension,
+  rowMajorOrder,
+  visits,
+  transitions,
+  travelTime,
+}: BinLayoutInput): number[] => {
+  const binCount = gridDimension * gridDimension;
+  const cells = Array.from({ length: binCount }, (_, i) => binGridPosition(i + 1, gridDimension, rowMajorOrder));
+  const time = cells.map((a) => cells.map((b) => travelTime(b.x - a.x, b.y - a.y)));
+  const center = Math.floor((binCount + 1) / 2) - 1;
+
+  const totalVisits = visits.reduce((sum, count) => sum + count, 0) || 1;
+  const totalTransitions = transitions.reduce((sum, row) => sum + row.reduce((s, count) => s + count, 0), 0) || 1;
+  // Moves go both ways, so only the combined count of a pair matters
+  const pairWeight = Array.from({ length: binCount }, (_, i) =>
+    Array.from(
+      { length: binCount },
+      (_, j) => ((transitions[i]?.[j] ?? 0) + (transitions[j]?.[i] ?? 0)) / totalTransitions,
+    ),
+  );
+  const centerWeight = Array.from({ length: binCount }, (_, i) => (CENTER_WEIGHT * (visits[i] ?? 0)) / totalVisits);
+
+  // Most visited logical bins on the physical bins closest to the center
+  const byVisits = [...Array(binCount).keys()].sort((a, b) => (visits[b] ?? 0) - (visits[a] ?? 0) || a - b);
+  const byCenter = [...Array(binCount).keys()].sort((a, b) => time[center][a] - time[center][b] || a - b);
+  const layout = new Array<number>(binCount);
+  byVisits.forEach((logical, rank) => (layout[logical] = byCenter[rank]));
+
+  // Cost change of exchanging the physical bins of logical bins a and b
+  const swapDelta = (a: number, b: number): number => {
+    const pa = layout[a];
+    const pb = layout[b];
+    let delta = (centerWeight[a] - centerWeight[b]) * (time[center][pb] - time[center][pa]);
+    for (let k = 0; k < binCount; k++) {
+      if (k === a || k === b) continue;
+      const pk = layout[k];
+      delta += (pairWeight[a][k] - pairWeight[b][k]) * (time[pb][pk] - time[pa][pk]);
+    }
+    return delta;
+  };
+
+  for (let pass = 0; pass < MAX_SWAP_PASSES; pass++) {
+    let improved = false;
+    for (let a = 0; a < binCount; a++) {
+      for (let b = a + 1; b < binCount; b++) {
+        if (swapDelta(a, b) < -1e-9) {
+          [layout[a], layout[b]] = [layout[b], layout[a]];
+          improved = true;
+        }
+      }
+    }
+    if (!improved) break;
+  }
+
+  return layout.map((physical) => physical + 1);
+};
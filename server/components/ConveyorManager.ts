@@ -8,6 +8,11 @@ import { SpeedManager } from './SpeedManager';
 import { SorterManager } from './SorterManager';
 import { DeviceName } from '../../types/deviceName.type';
 import { SortPartDto } from '../../types/sortPart.dto';
+import { ConveyorOdometry } from './ConveyorOdometry';
+
+// How far ahead of the jet time a timestamped fire command is sent to the conveyor.
+// Large enough to absorb event loop and serial latency, small enough that parts are rarely rescheduled after sending.
+const JET_SCHEDULE_LEAD_MS = 300;
 
 interface ReturnToDefaultSpeed {
   time: number;
@@ -37,6 +42,7 @@ export class ConveyorManager extends BaseComponent {
   private speedLog: { time: number; speed: number }[] = [];
   private isRecalculating: boolean = false;
   private returnToDefaultConveyorSpeed: ReturnToDefaultSpeed | null = null;
+  private odometry: ConveyorOdometry = new ConveyorOdometry(0);
 
   constructor(config: ConveyorManagerConfig) {
     super('ConveyorManager');
@@ -64,6 +70,11 @@ export class ConveyorManager extends BaseComponent {
       this.partQueue = [];
       this.speedLog = [];
 
+      // Encoder pulses per millisecond at the default speed map pulses to pixels
+      const pulsesPerMs = (settings.maxConveyorRPM * settings.conveyorPulsesPerRevolution) / 60000;
+      this.odometry.setPixelsPerPulse(pulsesPerMs > 0 ? settings.conveyorSpeed / pulsesPerMs : 0);
+      this.deviceManager.registerOdometryCallback(this.handleOdometrySample);
+
       // Register for settings updates
       this.settingsManager.registerSettingsUpdateCallback(this.reinitialize.bind(this));
 
@@ -81,12 +92,9 @@ export class ConveyorManager extends BaseComponent {
   public async deinitialize(): Promise<void> {
     // Unregister settings callback
     this.settingsManager.unregisterSettingsUpdateCallback(this.reinitialize.bind(this));
+    this.deviceManager.unregisterOdometryCallback(this.handleOdometrySample);
     // clear all part actions
-    this.partQueue.forEach((part) => {
-      if (part.moveRef) clearTimeout(part.moveRef);
-      if (part.jetRef) clearTimeout(part.jetRef);
-      if (part.conveyorSpeedRef) clearTimeout(part.conveyorSpeedRef);
-    });
+    this.cancelPartActions(this.partQueue);
     if (this.returnToDefaultConveyorSpeed) {
       clearTimeout(this.returnToDefaultConveyorSpeed.ref);
       this.returnToDefaultConveyorSpeed = null;
@@ -145,12 +153,30 @@ export class ConveyorManager extends BaseComponent {
     this.trimSpeedLog();
   }
 
+  private handleOdometrySample = (hostMs: number, position: number): void => {
+    this.odometry.addSample(hostMs, position);
+  };
+
   public findTimeAfterDistance = (startTime: number, distance: number) => {
     // sanity checks
     if (distance < 0) console.warn('findTimeAfterDistance: distance is negative');
 
     if (distance === 0) return startTime; // exit condition
 
+    // Use the measured belt travel for the part of the trip that already happened
+    if (this.odometry.isActive(Date.now())) {
+      const measuredTime = this.odometry.timeAfterDistance(startTime, distance);
+      if (measuredTime !== null) return measuredTime;
+
+      const latestTime = this.odometry.getLatestTime();
+      const travelled = latestTime !== null ? this.odometry.distanceBetween(startTime, latestTime) : null;
+      if (latestTime !== null && travelled !== null) {
+        // Predict only the rest of the trip from commanded speeds
+        startTime = latestTime;
+        distance -= travelled;
+      }
+    }
+
     // Combine historical speed changes from speedLog with future speed changes from partQueue and return to default speed
     const allSpeedChanges: { time: number; speed: number }[] = [
       // Add historical speed changes from speedLog
@@ -213,11 +239,43 @@ export class ConveyorManager extends BaseComponent {
   };
 
   public scheduleJetFire(jet: number, jetTime: number, part: Part): NodeJS.Timeout {
-    const delay = jetTime - Date.now();
+    // Tie the fire to the encoder position at which the part reaches the jet, independent of belt speed
+    const triggerPosition = this.findJetTriggerPosition(part);
+    if (triggerPosition !== null) {
+      this.deviceManager.sendCommand(
+        DeviceName.CONVEYOR_JETS,
+        `${ArduinoCommands.FIRE_JET_AT_POSITION}${jet},${triggerPosition}`,
+      );
+      part.jetFireAtPosition = triggerPosition;
+      return setTimeout(() => this.markPartSorted(part.initialTime), jetTime - Date.now());
+    }
+
+    const clock = this.deviceManager.getDeviceClock(DeviceName.CONVEYOR_JETS);
+    if (!clock?.isSynced()) {
+      // No device timebase yet, fall back to firing on the host timer
+      const delay = jetTime - Date.now();
+      return setTimeout(() => {
+        this.deviceManager.sendCommand(DeviceName.CONVEYOR_JETS, ArduinoCommands.FIRE_JET, jet);
+        this.markPartSorted(part.initialTime);
+      }, delay);
+    }
+
+    // Hand the fire time to the conveyor ahead of time so the device fires it on its own clock
+    const sendDelay = jetTime - JET_SCHEDULE_LEAD_MS - Date.now();
     return setTimeout(() => {
-      this.deviceManager.sendCommand(DeviceName.CONVEYOR_JETS, ArduinoCommands.FIRE_JET, jet);
-      this.markPartSorted(part.initialTime);
-    }, delay);
+      const fireAtUs = clock.hostToDeviceMicros(jetTime);
+      this.deviceManager.sendCommand(DeviceName.CONVEYOR_JETS, `${ArduinoCommands.FIRE_JET_AT}${jet},${fireAtUs}`);
+      part.jetFireAtUs = fireAtUs;
+      part.jetRef = setTimeout(() => this.markPartSorted(part.initialTime), jetTime - Date.now());
+    }, sendDelay);
+  }
+
+  private findJetTriggerPosition(part: Part): number | null {
+    if (!this.settingsManager.getSettings()?.positionTriggeredJets || !this.odometry.isActive(Date.now())) {
+      return null;
+    }
+    const distanceToJet = this.getJetPosition(part.sorter) - part.initialPosition;
+    return this.odometry.devicePositionAfterDistance(part.initialTime, distanceToJet);
   }
 
   private scheduleReturnToDefaultSpeed(jetTime: number): void {
@@ -314,6 +372,7 @@ export class ConveyorManager extends BaseComponent {
           bin: p.bin,
           sorter: p.sorter,
         });
+        recalculatedPart.binRecorded = p.binRecorded;
         // Insert the recalculated part
         this.insertPart(recalculatedPart);
       });
@@ -324,7 +383,7 @@ export class ConveyorManager extends BaseComponent {
 
   private schedulePartActions(part: Part): void {
     // Schedule move action
-    part.moveRef = this.sorterManager.scheduleSorterMove(part.sorter, part.bin, part.moveTime);
+    part.moveRef = this.sorterManager.scheduleSorterMove(part.sorter, part.bin, part.moveTime, part);
 
     // Schedule jet action
     part.jetRef = this.scheduleJetFire(part.sorter, part.jetTime, part);
@@ -342,6 +401,38 @@ export class ConveyorManager extends BaseComponent {
       if (part.moveRef) clearTimeout(part.moveRef);
       if (part.jetRef) clearTimeout(part.jetRef);
       if (part.conveyorSpeedRef) clearTimeout(part.conveyorSpeedRef);
+      // A timestamped jet fire already queued on the device must be removed there as well
+      if (part.jetFireAtUs !== undefined) {
+        try {
+          this.deviceManager.sendCommand(
+            DeviceName.CONVEYOR_JETS,
+            `${ArduinoCommands.CANCEL_JET_AT}${part.sorter},${part.jetFireAtUs}`,
+          );
+        } catch (error) {
+          console.error('\x1b[33mError cancelling scheduled jet fire:\x1b[0m', error);
+        }
+        part.jetFireAtUs = undefined;
+      }
+      // Likewise a move already queued on the sorter
+      if (part.moveId !== undefined) {
+        try {
+          this.sorterManager.cancelQueuedMove(part.sorter, part.moveId);
+        } catch (error) {
+          console.error('\x1b[33mError cancelling queued sorter move:\x1b[0m', error);
+        }
+        part.moveId = undefined;
+      }
+      if (part.jetFireAtPosition !== undefined) {
+        try {
+          this.deviceManager.sendCommand(
+            DeviceName.CONVEYOR_JETS,
+            `${ArduinoCommands.CANCEL_JET_AT_POSITION}${part.sorter},${part.jetFireAtPosition}`,
+          );
+        } catch (error) {
+          console.error('\x1b[33mError cancelling position-triggered jet fire:\x1b[0m', error);
+        }
+        part.jetFireAtPosition = undefined;
+      }
     });
   }
 
@@ -0,0 +1,131 @@
+interface OdometrySample {
+  hostMs: number; // host time of the sample (epoch ms)
+  position: number; // unwrapped encoder pulses since the controller booted
+}
+
+/**
+ * Measured conveyor travel from the conveyor controller's encoder odometry.
+ *
+ * The controller streams its cumulative encoder position as 'O:<micros>,<position>' (or an 'O' frame in binary
+ * mode), stamped with the time of the newest pulse. Once converted to host time the samples give the distance the
+ * belt actually moved between two moments, so arrival predictions don't depend on the belt following the commanded
+ * speed. Positions between samples are interpolated linearly.
+ */
+export class ConveyorOdometry {
+  private static readonly HISTORY_MS = 120000; // longer than any part stays on the belt
+  private static readonly STALE_MS = 1000; // without fresh samples callers fall back to commanded speeds
+  private static readonly POSITION_WRAP = 2 ** 32;
+
+  private samples: OdometrySample[] = [];
+  private lastRawPosition: number | null = null;
+  private wrapOffset = 0;
+
+  constructor(private pixelsPerPulse: number) {}
+
+  public setPixelsPerPulse(pixelsPerPulse: number): void {
+    this.pixelsPerPulse = pixelsPerPulse;
+  }
+
+  public addSample(hostMs: number, rawPosition: number): void {
+    if (this.lastRawPosition !== null && rawPosition < this.lastRawPosition) {
+      if (this.lastRawPosition - rawPosition > ConveyorOdometry.POSITION_WRAP / 2) {
+        this.wrapOffset += ConveyorOdometry.POSITION_WRAP;
+      } else {
+        // The controller was reset and counts from zero again
+        this.reset();
+      }
+    }
+    this.lastRawPosition = rawPosition;
+
+    const last = this.samples[this.samples.length - 1];
+    if (last && hostMs <= last.hostMs) return; // clock correction moved the sample back in time
+
+    this.samples.push({ hostMs, position: this.wrapOffset + rawPosition });
+    while (this.samples.length > 2 && hostMs - this.samples[0].hostMs > ConveyorOdometry.HISTORY_MS) {
+      this.samples.shift();
+    }
+  }
+
+  public reset(): void {
+    this.samples = [];
+    this.lastRawPosition = null;
+    this.wrapOffset = 0;
+  }
+
+  public isActive(now: number): boolean {
+    const last = this.samples[this.samples.length - 1];
+    return this.samples.length >= 2 && this.pixelsPerPulse > 0 && now - last.hostMs <= ConveyorOdometry.STALE_MS;
+  }
+
+  public getLatestTime(): number | null {
+    return this.samples.length > 0 ? this.samples[this.samples.length - 1].hostMs : null;
+  }
+
+  // Pixels travelled between two times, null if either lies outside the sampled window
+  public distanceBetween(startMs: number, endMs: number): number | null {
+    const start = this.positionAt(startMs);
+    const end = this.positionAt(endMs);
+    if (start === null || end === null) return null;
+    return (end - start) * this.pixelsPerPulse;
+  }
+
+  // Time at which the belt had moved `distance` pixels since startMs, null if it hasn't (yet) within the window
+  public timeAfterDistance(startMs: number, distance: number): number | null {
+    const start = this.positionAt(startMs);
+    if (start === null || this.pixelsPerPulse <= 0) return null;
+    const target = start + distance / this.pixelsPerPulse;
+
+    const index = this.findFirstIndex((sample) => sample.position >= target && sample.hostMs >= startMs);
+    if (index === -1) return null;
+    const after = this.samples[index];
+    const before = this.samples[index - 1];
+    if (!before || before.hostMs < startMs || after.position === before.position) {
+      return Math.max(after.hostMs, startMs);
+    }
+    const fraction = (target - before.position) / (after.position - before.position);
+    return before.hostMs + fraction * (after.hostMs - before.hostMs);
+  }
+
+  // Device encoder position (as counted by the controller) the belt reaches `distance` pixels after startMs.
+  // startMs may be slightly newer than the latest sample, the position is then extrapolated from the last speed.
+  public devicePositionAfterDistance(startMs: number, distance: number): number | null {
+    if (this.samples.length < 2 || this.pixelsPerPulse <= 0) return null;
+    let start = this.positionAt(startMs);
+    if (start === null) {
+      const last = this.samples[this.samples.length - 1];
+      const previous = this.samples[this.samples.length - 2];
+      const sinceLast = startMs - last.hostMs;
+      if (sinceLast < 0 || sinceLast > ConveyorOdometry.STALE_MS) return null;
+      const pulsesPerMs = (last.position - previous.position) / (last.hostMs - previous.hostMs);
+      start = last.position + pulsesPerMs * sinceLast;
+    }
+    const target = Math.round(start + distance / this.pixelsPerPulse);
+    return target % ConveyorOdometry.POSITION_WRAP;
+  }
+
+  private positionAt(hostMs: number): number | null {
+    if (this.samples.length === 0) return null;
+    const first = this.samples[0];
+    const last = this.samples[this.samples.length - 1];
+    if (hostMs < first.hostMs || hostMs > last.hostMs) return null;
+
+    const index = this.findFirstIndex((sample) => sample.hostMs >= hostMs);
+    const after = this.samples[index];
+    const before = this.samples[index - 1];
+    if (!before || after.hostMs === hostMs) return after.position;
+    const fraction = (hostMs - before.hostMs) / (after.hostMs - before.hostMs);
+    return before.position + fraction * (after.position - before.position);
+  }
+
+  // Binary search over samples, which are ordered by both time and position
+  private findFirstIndex(predicate: (sample: OdometrySample) => boolean): number {
+    let low = 0;
+    let high = this.samples.length;
+    while (low < high) {
+      const mid = (low + high) >> 1;
+      if (predicate(this.samples[mid])) high = mid;
+      else low = mid + 1;
+    }
+    return low < this.samples.length ? low : -1;
+  }
+}
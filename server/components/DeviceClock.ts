@@ -0,0 +1,187 @@
+import { performance } from 'perf_hooks';
+
+// Host timestamp in epoch milliseconds with sub-millisecond resolution.
+// Matches the Date.now() timebase used throughout the server.
+export const hostNow = (): number => performance.timeOrigin + performance.now();
+
+interface ClockSample {
+  hostMs: number; // host time at which the device took its timestamp (round-trip midpoint)
+  deviceUs: number; // unwrapped device micros()
+  latencyMs: number; // round-trip time left after removing serial transfer time
+}
+
+interface PendingPing {
+  sentAt: number;
+  txBytes: number;
+}
+
+/**
+ * Tracks the offset and drift between the host clock and a device's micros() clock.
+ *
+ * The host sends 't<seq>' pings and the device answers 'T:<seq>,<micros>' (or a 'T' frame in binary mode)
+ * with the time at which the ping's last byte arrived. Each exchange is halved NTP-style after removing the known serial transfer
+ * time of both messages, slow round trips are discarded as outliers, and a least squares fit over the
+ * remaining window gives a smoothed offset and drift.
+ */
+export class DeviceClock {
+  private static readonly MAX_SAMPLES = 32;
+  private static readonly MIN_SAMPLES_FOR_SYNC = 4;
+  private static readonly MIN_DRIFT_SPAN_MS = 5000; // fit drift only once samples span this long
+  private static readonly MAX_DRIFT = 0.02; // Arduino ceramic resonators are within ~0.5%
+  private static readonly LATENCY_OUTLIER_FACTOR = 1.5;
+  private static readonly LATENCY_OUTLIER_SLACK_MS = 2;
+  private static readonly MAX_PENDING_PINGS = 8;
+  private static readonly UNSYNCED_PING_INTERVAL_MS = 250;
+  private static readonly SYNCED_PING_INTERVAL_MS = 2000;
+  private static readonly MICROS_WRAP = 2 ** 32;
+
+  private seq = 0;
+  private pendingPings: Map<number, PendingPing> = new Map();
+  private samples: ClockSample[] = [];
+  private lastRawDeviceUs: number | null = null;
+  private wrapOffsetUs = 0;
+  private lastPingAt = 0;
+
+  // Fitted model: deviceUs = offsetUs + rate * (hostMs - refHostMs) * 1000
+  private refHostMs = 0;
+  private offsetUs = 0;
+  private rate = 1;
+  private syncedSampleCount = 0;
+
+  constructor(private baudRate: number) {}
+
+  public setBaudRate(baudRate: number): void {
+    this.baudRate = baudRate;
+  }
+
+  public isSynced(): boolean {
+    return this.syncedSampleCount >= DeviceClock.MIN_SAMPLES_FOR_SYNC;
+  }
+
+  public isPingDue(now: number): boolean {
+    const interval = this.isSynced() ? DeviceClock.SYNCED_PING_INTERVAL_MS : DeviceClock.UNSYNCED_PING_INTERVAL_MS;
+    return now - this.lastPingAt >= interval;
+  }
+
+  public nextPingSeq(): number {
+    const seq = this.seq;
+    this.seq = (this.seq + 1) % 1000000;
+    return seq;
+  }
+
+  // txBytes is the size of the ping on the wire, which differs between ASCII and binary framing
+  public recordPingSent(seq: number, txBytes: number): void {
+    const sentAt = hostNow();
+    this.lastPingAt = sentAt;
+    this.pendingPings.set(seq, { sentAt, txBytes });
+
+    // Forget pings that were never answered
+    if (this.pendingPings.size > DeviceClock.MAX_PENDING_PINGS) {
+      const oldestSeq = this.pendingPings.keys().next().value;
+      if (oldestSeq !== undefined) this.pendingPings.delete(oldestSeq);
+    }
+  }
+
+  // Feed a 'T:<seq>,<micros>' response or 'T' frame. receivedAt must be captured as soon as it arrives.
+  public handlePong(seq: number, rawDeviceUs: number, receivedAt: number, rxBytes: number): boolean {
+    const ping = this.pendingPings.get(seq);
+    if (!ping) return false;
+    this.pendingPings.delete(seq);
+
+    const deviceUs = this.unwrapPong(rawDeviceUs);
+    const txMs = this.serialTransferMs(ping.txBytes);
+    const rxMs = this.serialTransferMs(rxBytes);
+    const latencyMs = receivedAt - ping.sentAt - txMs - rxMs;
+    if (latencyMs < 0) return false;
+
+    // The device stamps the ping once its last byte arrived and answers right away
+    const hostMs = (ping.sentAt + txMs + (receivedAt - rxMs)) / 2;
+
+    this.samples.push({ hostMs, deviceUs, latencyMs });
+    if (this.samples.length > DeviceClock.MAX_SAMPLES) {
+      this.samples.shift();
+    }
+    this.refit();
+    return true;
+  }
+
+  // Convert a host timestamp (epoch ms) to the device's micros() value, including rollover
+  public hostToDeviceMicros(hostMs: number): number {
+    const deviceUs = Math.round(this.hostToDeviceUs(hostMs));
+    return ((deviceUs % DeviceClock.MICROS_WRAP) + DeviceClock.MICROS_WRAP) % DeviceClock.MICROS_WRAP;
+  }
+
+  // Convert a raw device micros() value to a host timestamp (epoch ms)
+  public deviceMicrosToHost(rawDeviceUs: number): number {
+    // Pick the rollover period closest to where the device clock is right now
+    const expectedUs = this.hostToDeviceUs(hostNow());
+    let deviceUs = this.wrapOffsetUs + rawDeviceUs;
+    while (deviceUs - expectedUs > DeviceClock.MICROS_WRAP / 2) deviceUs -= DeviceClock.MICROS_WRAP;
+    while (expectedUs - deviceUs > DeviceClock.MICROS_WRAP / 2) deviceUs += DeviceClock.MICROS_WRAP;
+    return this.refHostMs + (deviceUs - this.offsetUs) / this.rate / 1000;
+  }
+
+  public getStats(): { synced: boolean; offsetUs: number; driftPpm: number; latencyMs: number; samples: number } {
+    const latencies = this.samples.map((s) => s.latencyMs);
+    return {
+      synced: this.isSynced(),
+      offsetUs: this.offsetUs,
+      driftPpm: (this.rate - 1) * 1e6,
+      latencyMs: latencies.length > 0 ? Math.min(...latencies) : 0,
+      samples: this.syncedSampleCount,
+    };
+  }
+
+  private hostToDeviceUs(hostMs: number): number {
+    return this.offsetUs + this.rate * (hostMs - this.refHostMs) * 1000;
+  }
+
+  private serialTransferMs(bytes: number): number {
+    // 8N1 framing: 10 bits per byte
+    return (bytes * 10 * 1000) / this.baudRate;
+  }
+
+  private unwrapPong(rawDeviceUs: number): number {
+    if (this.lastRawDeviceUs !== null && this.lastRawDeviceUs - rawDeviceUs > DeviceClock.MICROS_WRAP / 2) {
+      this.wrapOffsetUs += DeviceClock.MICROS_WRAP;
+    }
+    this.lastRawDeviceUs = rawDeviceUs;
+    return this.wrapOffsetUs + rawDeviceUs;
+  }
+
+  private refit(): void {
+    // Keep only exchanges close to the fastest round trip; slow ones carry event loop or USB jitter
+    const minLatency = Math.min(...this.samples.map((s) => s.latencyMs));
+    const threshold = minLatency * DeviceClock.LATENCY_OUTLIER_FACTOR + DeviceClock.LATENCY_OUTLIER_SLACK_MS;
+    const good = this.samples.filter((s) => s.latencyMs <= threshold);
+    this.syncedSampleCount = good.length;
+
+    const ref = good[good.length - 1];
+    const span = ref.hostMs - good[0].hostMs;
+    let rate = 1;
+
+    if (good.length >= 2 && span >= DeviceClock.MIN_DRIFT_SPAN_MS) {
+      // Least squares slope of device time against host time
+      const meanX = good.reduce((sum, s) => sum + (s.hostMs - ref.hostMs) * 1000, 0) / good.length;
+      const meanY = good.reduce((sum, s) => sum + (s.deviceUs - ref.deviceUs), 0) / good.length;
+      let sxy = 0;
+      let sxx = 0;
+      for (const s of good) {
+        const dx = (s.hostMs - ref.hostMs) * 1000 - meanX;
+        sxy += dx * (s.deviceUs - ref.deviceUs - meanY);
+        sxx += dx * dx;
+      }
+      if (sxx > 0) {
+        rate = Math.min(Math.max(sxy / sxx, 1 - DeviceClock.MAX_DRIFT), 1 + DeviceClock.MAX_DRIFT);
+      }
+    }
+
+    // Offset at the newest sample, averaged over the window using the fitted rate
+    this.refHostMs = ref.hostMs;
+    this.rate = rate;
+    this.offsetUs =
+      ref.deviceUs +
+      good.reduce((sum, s) => sum + (s.deviceUs - ref.deviceUs) - rate * (s.hostMs - ref.hostMs) * 1000, 0) /
+        good.length;
+  }
+}
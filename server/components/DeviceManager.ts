@@ -1,9 +1,54 @@
 import { BaseComponent, ComponentConfig, ComponentStatus } from './BaseComponent';
 import { ArduinoConfig, DeviceType } from './arduinoConfig.type';
-import { SerialPort, ReadlineParser, SerialPortMock } from 'serialport';
+import { SerialPort, SerialPortMock } from 'serialport';
 import { SocketManager } from './SocketManager';
 import { SettingsManager } from './SettingsManager';
 import { DeviceName, DeviceInfo } from '../../types/deviceName.type';
+import { DeviceClock, hostNow } from './DeviceClock';
+import {
+  SerialFrame,
+  SerialFrameParser,
+  SerialPacket,
+  encodeCommandFrame,
+  FRAME_OP_ACK,
+  FRAME_OP_NAK,
+  FRAME_NAK_REASONS,
+} from './SerialFrame';
+import { ArduinoCommands } from '../../types/arduinoCommands.type';
+import { hopperCyclePolicies } from '../../types/settings.type';
+import { isValidBinLayout } from './BinLayoutOptimizer';
+
+interface PendingAck {
+  message: string;
+  timeout: NodeJS.Timeout;
+}
+
+export type OdometryCallback = (hostMs: number, position: number) => void;
+export type MoveTimeCallback = (
+  deviceName: DeviceName,
+  fromBin: number,
+  toBin: number,
+  durationMs: number,
+  axisMs?: { x: number; y: number }, // time each axis took to stop
+) => void;
+export type MovePredictionCallback = (
+  deviceName: DeviceName,
+  fromBin: number,
+  toBin: number,
+  durationMs: number,
+) => void;
+export type SorterParkCallback = (deviceName: DeviceName, bin: number) => void;
+export type SorterDriftCallback = (deviceName: DeviceName, xDrift: number, yDrift: number) => void;
+export type DeviceReadyCallback = (deviceName: DeviceName) => void;
+// A part arrived at or left the feeder sensor, dwellMs is how long it was there (left events only)
+export type FeederPartCallback = (event: 'arrived' | 'left', hostMs: number, dwellMs?: number) => void;
+
+interface BaudNegotiation {
+  baudRate: number;
+  switched: boolean; // device answered 'Baud: <rate>' and the port was switched
+  fellBack: boolean; // no confirmation, waiting for the device to return to the default rate
+  timeout: NodeJS.Timeout;
+}
 
 export interface DeviceManagerConfig extends ComponentConfig {
   socketManager: SocketManager;
@@ -25,6 +70,42 @@ export class DeviceManager extends BaseComponent {
   private awaitingSettingsAck: Map<DeviceName, boolean> = new Map();
   private settingsAckTimeouts: Map<DeviceName, NodeJS.Timeout> = new Map();
   private readonly SETTINGS_ACK_TIMEOUT_MS = 5000;
+  private readonly DEFAULT_BAUD_RATE = 9600;
+  // Host/device clock synchronization
+  private clocks: Map<DeviceName, DeviceClock> = new Map();
+  private clockSyncTimer: NodeJS.Timeout | null = null;
+  private readonly CLOCK_SYNC_TICK_MS = 250;
+  // Binary framed protocol state
+  private frameParsers: Map<DeviceName, SerialFrameParser> = new Map();
+  private frameSeqs: Map<DeviceName, number> = new Map();
+  private pendingAcks: Map<DeviceName, Map<number, PendingAck>> = new Map();
+  private readonly FRAME_ACK_TIMEOUT_MS = 1000;
+  // Baud rate negotiation, stable and failed rates are remembered per serial port and saved across restarts
+  private baudNegotiations: Map<DeviceName, BaudNegotiation> = new Map();
+  private stableBaudRates: Map<string, number> = new Map();
+  private failedBaudRates: Map<string, Set<number>> = new Map();
+  private readonly BAUD_RATE_CANDIDATES = [500000, 250000, 115200];
+  private readonly BAUD_CONFIRM_TIMEOUT_MS = 1000;
+  private readonly BAUD_FALLBACK_TIMEOUT_MS = 3000; // the device reverts after 2000 ms
+  // Firmware log levels, see arduino_code/serial_log.h
+  private readonly LOG_ALL_SUBSYSTEMS = 255;
+  private readonly LOG_LEVEL_DEBUG = 4;
+  private readonly FEEDFORWARD_POINTS = 6; // see FEEDFORWARD_POINTS in conveyor_jets.cpp
+  private readonly FILL_SENSOR = 1; // see SENSOR_FILL in hopper_feeder.cpp
+  // Bins per 'B' message. 'B<START>' and 12 ',<BIN>' fields of up to 3 digits are at most 52 characters, within the
+  // sorter's 80 byte ASCII message buffer (MAX_MESSAGE_LENGTH) and the 64 byte text frame payload (FRAME_MAX_PAYLOAD).
+  private readonly BIN_MAP_CHUNK = 12;
+  // Conveyor encoder position samples, delivered in host time
+  private odometryCallbacks: OdometryCallback[] = [];
+  // Sorter move durations measured on the device
+  private moveTimeCallbacks: MoveTimeCallback[] = [];
+  private movePredictionCallbacks: MovePredictionCallback[] = [];
+  private sorterParkCallbacks: SorterParkCallback[] = [];
+  private sorterDriftCallbacks: SorterDriftCallback[] = [];
+  // Part edge events from the feeder sensor
+  private feederPartCallbacks: FeederPartCallback[] = [];
+  // Called once a device acknowledged its settings or had them resent, for runtime state owned by other components
+  private deviceReadyCallbacks: DeviceReadyCallback[] = [];
 
   constructor(config: DeviceManagerConfig) {
     super('DeviceManager');
@@ -43,6 +124,8 @@ export class DeviceManager extends BaseComponent {
         throw new Error('Settings not available');
       }
 
+      await this.loadSerialLinkStates();
+
       // Connect to devices based on settings
       if (settings.conveyorJetsSerialPort) {
         await this.connectDevice(DeviceName.CONVEYOR_JETS, settings.conveyorJetsSerialPort, {
@@ -84,6 +167,11 @@ export class DeviceManager extends BaseComponent {
             HOMING_SPEED: sorter.homingSpeed,
             SPEED: sorter.speed,
             ROW_MAJOR_ORDER: sorter.rowMajorOrder,
+            HOMING_FAST_SPEED: sorter.homingFastSpeed,
+            Y_ACCELERATION: sorter.yAcceleration,
+            Y_SPEED: sorter.ySpeed,
+            SYNCHRONIZED_MOVES: sorter.synchronizedMoves,
+            S_CURVE_STEPS: sorter.sCurveSteps,
           });
         } catch (error) {
           console.error(`\x1b[33mFailed to connect to sorter ${deviceName} at ${sorter.serialPort}:\x1b[0m`, error);
@@ -97,6 +185,7 @@ export class DeviceManager extends BaseComponent {
 
       this.setStatus(ComponentStatus.READY);
       this.startPeriodicPortScan();
+      this.startClockSync();
     } catch (error) {
       console.error('\x1b[33mError in device manager initialization:\x1b[0m', error);
       this.setError(error instanceof Error ? error.message : 'Unknown error initializing device manager');
@@ -119,6 +208,14 @@ export class DeviceManager extends BaseComponent {
       console.log('Stopped periodic port scanning.');
     }
 
+    if (this.clockSyncTimer) {
+      clearInterval(this.clockSyncTimer);
+      this.clockSyncTimer = null;
+    }
+    for (const deviceName of this.devices.keys()) {
+      this.clearLinkState(deviceName);
+    }
+
     for (const [deviceName, deviceInfo] of this.devices) {
       try {
         await new Promise<void>((resolve, reject) => {
@@ -151,6 +248,8 @@ export class DeviceManager extends BaseComponent {
         config,
       };
       this.devices.set(deviceName, deviceInfo);
+      // Opening the port resets the Arduino, so any previous clock estimate is invalid
+      this.clocks.set(deviceName, new DeviceClock(this.DEFAULT_BAUD_RATE));
       this.socketManager.emitComponentStatusUpdate(deviceName, ComponentStatus.READY, null);
 
       // Add error listener for hopper_feeder
@@ -213,6 +312,7 @@ export class DeviceManager extends BaseComponent {
       }
 
       this.devices.delete(deviceName);
+      this.clearLinkState(deviceName);
       console.log(`Device ${deviceName} removed from active devices map.`);
 
       // Task 1.3.2: Emit component status update via SocketManager
@@ -308,6 +408,7 @@ export class DeviceManager extends BaseComponent {
         });
       });
       this.devices.delete(deviceName);
+      this.clearLinkState(deviceName);
       this.socketManager.emitComponentStatusUpdate(deviceName, ComponentStatus.UNINITIALIZED, null);
     }
   }
@@ -317,10 +418,10 @@ export class DeviceManager extends BaseComponent {
     try {
       // Create the device without error callback in constructor
       const device = isDevMode
-        ? new SerialPortMock({ path: portName, baudRate: 9600 })
+        ? new SerialPortMock({ path: portName, baudRate: this.DEFAULT_BAUD_RATE })
         : new SerialPort({
             path: portName,
-            baudRate: 9600,
+            baudRate: this.DEFAULT_BAUD_RATE,
           });
 
       // Wait for the port to be fully opened
@@ -342,11 +443,16 @@ export class DeviceManager extends BaseComponent {
         });
       });
 
-      // Set up the parser to process incoming data
-      const parser = device.pipe(new ReadlineParser({ delimiter: '\r\n' }));
-      parser.on('data', (data) => {
-        this.handleDeviceData(deviceName, data);
+      // Set up the parser to split incoming data into text lines and binary frames
+      const parser = device.pipe(new SerialFrameParser());
+      parser.on('data', (packet: SerialPacket) => {
+        if (packet.type === 'line') {
+          this.handleDeviceData(deviceName, packet.text);
+        } else {
+          this.handleDeviceFrame(deviceName, packet.frame);
+        }
       });
+      this.frameParsers.set(deviceName, parser);
 
       return device;
     } catch (error) {
@@ -367,6 +473,11 @@ export class DeviceManager extends BaseComponent {
       config.HOMING_SPEED,
       config.SPEED,
       config.ROW_MAJOR_ORDER ? 1 : 0,
+      config.HOMING_FAST_SPEED,
+      config.Y_ACCELERATION,
+      config.Y_SPEED,
+      config.SYNCHRONIZED_MOVES ? 1 : 0,
+      config.S_CURVE_STEPS,
     ];
     return 's,' + configValues.join(',');
   }
@@ -390,7 +501,9 @@ export class DeviceManager extends BaseComponent {
       ',' +
       Math.round(settings.conveyorKi * 100) +
       ',' +
-      Math.round(settings.conveyorKd * 100)
+      Math.round(settings.conveyorKd * 100) +
+      ',' +
+      settings.conveyorRampRPMPerSecond
     );
   }
 
@@ -407,50 +520,269 @@ export class DeviceManager extends BaseComponent {
     return 's,' + configValues.join(',');
   }
 
+  private sendDeviceSettings(deviceInfo: DeviceInfo): void {
+    const { deviceName } = deviceInfo;
+    let configMessage = '';
+    switch (deviceInfo.config.deviceType) {
+      case DeviceType.SORTER:
+        configMessage = this.buildSorterInitMessage(deviceInfo.config);
+        break;
+      case DeviceType.CONVEYOR_JETS:
+        configMessage = this.buildConveyorJetsInitMessage(deviceInfo.config);
+        break;
+      case DeviceType.HOPPER_FEEDER:
+        configMessage = this.buildHopperFeederInitMessage(deviceInfo.config);
+        break;
+    }
+    if (configMessage) {
+      this.sendCommand(deviceName, configMessage);
+      this.awaitingSettingsAck.set(deviceName, true);
+      // Set up timeout for ack
+      const timeout = setTimeout(() => {
+        if (this.awaitingSettingsAck.get(deviceName)) {
+          console.warn(
+            `\x1b[33m[${deviceName}] Settings ack timeout. No acknowledgment received after sending settings.\x1b[0m`,
+          );
+          this.socketManager.emitComponentStatusUpdate(
+            deviceName,
+            ComponentStatus.ERROR,
+            'Settings ack timeout. No acknowledgment received.',
+          );
+          // Optionally: retry sending settings or alert user here
+          // For now, just log and mark as error
+          this.awaitingSettingsAck.delete(deviceName);
+        }
+      }, this.SETTINGS_ACK_TIMEOUT_MS);
+      this.settingsAckTimeouts.set(deviceName, timeout);
+    }
+  }
+
+  // --- Baud Rate Negotiation Methods ---
+  // Returns false if the device should stay at the default rate
+  private startBaudNegotiation(deviceInfo: DeviceInfo): boolean {
+    const { deviceName } = deviceInfo;
+    const baudRate = this.nextBaudRateCandidate(deviceInfo.portName);
+    if (!baudRate) return false;
+
+    this.baudNegotiations.set(deviceName, {
+      baudRate,
+      switched: false,
+      fellBack: false,
+      timeout: setTimeout(() => this.handleBaudNegotiationTimeout(deviceName), this.BAUD_CONFIRM_TIMEOUT_MS),
+    });
+    this.sendCommand(deviceName, ArduinoCommands.BAUD_RATE, baudRate);
+    return true;
+  }
+
+  // The remembered stable rate first, otherwise the fastest rate that hasn't failed on this port
+  private nextBaudRateCandidate(portName: string): number | null {
+    const maxBaudRate = this.settingsManager.getSettings()?.maxSerialBaudRate ?? this.DEFAULT_BAUD_RATE;
+    const failed = this.failedBaudRates.get(portName);
+    const stable = this.stableBaudRates.get(portName);
+    if (stable && stable <= maxBaudRate) return stable;
+
+    return (
+      this.BAUD_RATE_CANDIDATES.find(
+        (baudRate) => baudRate <= maxBaudRate && baudRate > this.DEFAULT_BAUD_RATE && !failed?.has(baudRate),
+      ) ?? null
+    );
+  }
+
+  private handleBaudRateSwitch(deviceInfo: DeviceInfo, baudRate: number): void {
+    const { deviceName } = deviceInfo;
+    const negotiation = this.baudNegotiations.get(deviceName);
+    if (!negotiation || negotiation.switched || negotiation.baudRate !== baudRate) return;
+
+    clearTimeout(negotiation.timeout);
+    negotiation.switched = true;
+    negotiation.timeout = setTimeout(() => this.handleBaudNegotiationTimeout(deviceName), this.BAUD_CONFIRM_TIMEOUT_MS);
+    this.setPortBaudRate(deviceInfo, baudRate)
+      .then(() => this.sendCommand(deviceName, ArduinoCommands.CONFIRM_BAUD_RATE))
+      .catch((err) => {
+        console.error(`\x1b[33m[${deviceName}] Failed to switch port to ${baudRate} baud:\x1b[0m`, err);
+      });
+  }
+
+  private handleBaudRateConfirmed(deviceInfo: DeviceInfo): void {
+    const { deviceName } = deviceInfo;
+    const negotiation = this.baudNegotiations.get(deviceName);
+    if (!negotiation || !negotiation.switched || negotiation.fellBack) return;
+
+    this.clearBaudNegotiation(deviceName);
+    if (this.stableBaudRates.get(deviceInfo.portName) !== negotiation.baudRate) {
+      this.stableBaudRates.set(deviceInfo.portName, negotiation.baudRate);
+      this.saveSerialLinkState(deviceInfo.portName);
+    }
+    console.log(`\x1b[32m[${deviceName}] Serial link running at ${negotiation.baudRate} baud.\x1b[0m`);
+    this.sendDeviceSettings(deviceInfo);
+  }
+
+  private handleBaudNegotiationTimeout(deviceName: DeviceName): void {
+    const negotiation = this.baudNegotiations.get(deviceName);
+    const deviceInfo = this.devices.get(deviceName);
+    if (!negotiation || !deviceInfo) return;
+
+    this.recordBaudRateFailure(deviceInfo.portName, negotiation.baudRate);
+
+    if (!negotiation.switched) {
+      // The device never answered, so it is still at the default rate
+      this.clearBaudNegotiation(deviceName);
+      this.sendDeviceSettings(deviceInfo);
+      return;
+    }
+
+    if (negotiation.fellBack) {
+      this.clearBaudNegotiation(deviceName);
+      this.socketManager.emitComponentStatusUpdate(deviceName, ComponentStatus.ERROR, 'Baud rate negotiation failed.');
+      return;
+    }
+
+    // The device reverts on its own and sends 'Ready' again at the default rate
+    console.warn(`\x1b[33m[${deviceName}] No confirmation at ${negotiation.baudRate} baud, falling back.\x1b[0m`);
+    negotiation.fellBack = true;
+    negotiation.timeout = setTimeout(() => this.handleBaudNegotiationTimeout(deviceName), this.BAUD_FALLBACK_TIMEOUT_MS);
+    this.setPortBaudRate(deviceInfo, this.DEFAULT_BAUD_RATE).catch((err) => {
+      console.error(`\x1b[33m[${deviceName}] Failed to restore default baud rate:\x1b[0m`, err);
+    });
+  }
+
+  private recordBaudRateFailure(portName: string, baudRate: number): void {
+    const failed = this.failedBaudRates.get(portName) ?? new Set<number>();
+    failed.add(baudRate);
+    this.failedBaudRates.set(portName, failed);
+    if (this.stableBaudRates.get(portName) === baudRate) {
+      this.stableBaudRates.delete(portName);
+    }
+    this.saveSerialLinkState(portName);
+  }
+
+  private async loadSerialLinkStates(): Promise<void> {
+    try {
+      const states = await this.settingsManager.getSerialLinkStates();
+      Object.entries(states).forEach(([portName, state]) => {
+        if (state.stableBaudRate) this.stableBaudRates.set(portName, state.stableBaudRate);
+        this.failedBaudRates.set(portName, new Set(state.failedBaudRates ?? []));
+      });
+    } catch (error) {
+      console.error('\x1b[33mError loading serial link state:\x1b[0m', error);
+    }
+  }
+
+  private saveSerialLinkState(portName: string): void {
+    this.settingsManager
+      .saveSerialLinkState(portName, {
+        stableBaudRate: this.stableBaudRates.get(portName) ?? null,
+        failedBaudRates: Array.from(this.failedBaudRates.get(portName) ?? []),
+      })
+      .catch((error) => {
+        console.error(`\x1b[33m[${portName}] Error saving serial link state:\x1b[0m`, error);
+      });
+  }
+
+  private clearBaudNegotiation(deviceName: DeviceName): void {
+    const negotiation = this.baudNegotiations.get(deviceName);
+    if (negotiation) clearTimeout(negotiation.timeout);
+    this.baudNegotiations.delete(deviceName);
+  }
+
+  private setPortBaudRate(deviceInfo: DeviceInfo, baudRate: number): Promise<void> {
+    return new Promise<void>((resolve, reject) => {
+      deviceInfo.device.update({ baudRate }, (err: Error | null | undefined) => {
+        if (err) reject(err);
+        else resolve();
+      });
+    }).then(() => {
+      this.clocks.get(deviceInfo.deviceName)?.setBaudRate(baudRate);
+    });
+  }
+
   private handleDeviceData(deviceName: DeviceName, data: string): void {
+    // Timestamp first so clock sync responses are not skewed by the work below
+    const receivedAt = hostNow();
+
     // Find the device info by port name
     const deviceInfo = this.devices.get(deviceName);
     if (!deviceInfo) {
       console.error(`\x1b[33mNo device info found for port ${deviceName}\x1b[0m`);
       return;
     }
+
+    // Clock sync responses and odometry samples are frequent, handle them without logging
+    if (data.startsWith('T:')) {
+      this.handleClockSyncResponse(deviceName, data, receivedAt);
+      return;
+    }
+
+    if (data.startsWith('O:')) {
+      const match = /^O:(\d+),(\d+)$/.exec(data.trim());
+      if (match) this.handleOdometrySample(deviceName, Number(match[1]), Number(match[2]));
+      return;
+    }
+
+    // Feeder part events, 'PA:<MICROS>' and 'PL:<MICROS>,<DWELL_MS>'
+    const partMatch = /^P([AL]):(\d+)(?:,(\d+))?$/.exec(data.trim());
+    if (partMatch) {
+      this.handleFeederPartEvent(
+        deviceName,
+        partMatch[1] === 'A' ? 'arrived' : 'left',
+        Number(partMatch[2]),
+        receivedAt,
+        partMatch[3] !== undefined ? Number(partMatch[3]) : undefined,
+      );
+      return;
+    }
+
     console.log(`\x1b[35m[RX <- ${deviceName}]\x1b[0m Received data: ${data}`);
 
+    // Handle sorter move durations, 'MT:<FROM_BIN>,<TO_BIN>,<DURATION_US>[,<X_US>,<Y_US>]'
+    const moveTimeMatch = /^MT:(\d+),(\d+),(\d+)(?:,(\d+),(\d+))?$/.exec(data.trim());
+    if (moveTimeMatch) {
+      this.handleMoveTime(
+        deviceName,
+        Number(moveTimeMatch[1]),
+        Number(moveTimeMatch[2]),
+        Number(moveTimeMatch[3]),
+        moveTimeMatch[4] !== undefined ? { x: Number(moveTimeMatch[4]), y: Number(moveTimeMatch[5]) } : undefined,
+      );
+      return;
+    }
+
+    // Handle sorter parking, 'PK:<BIN>'
+    const parkMatch = /^PK:(\d+)$/.exec(data.trim());
+    if (parkMatch) {
+      this.sorterParkCallbacks.forEach((callback) => callback(deviceName, Number(parkMatch[1])));
+      return;
+    }
+
+    // Handle sorter position checks, 'VD:<X_DRIFT>,<Y_DRIFT>'
+    const driftMatch = /^VD:(-?\d+),(-?\d+)$/.exec(data.trim());
+    if (driftMatch) {
+      this.sorterDriftCallbacks.forEach((callback) =>
+        callback(deviceName, Number(driftMatch[1]), Number(driftMatch[2])),
+      );
+      return;
+    }
+
+    // Handle sorter move predictions, 'MP:<FROM_BIN>,<TO_BIN>,<DURATION_US>'
+    const predictionMatch = /^MP:(\d+),(\d+),(\d+)$/.exec(data.trim());
+    if (predictionMatch) {
+      const [, fromBin, toBin, durationUs] = predictionMatch.map(Number);
+      this.movePredictionCallbacks.forEach((callback) => callback(deviceName, fromBin, toBin, durationUs / 1000));
+      return;
+    }
+
     // Handle handshake/acknowledgment protocol
     if (data.trim() === 'Ready') {
+      // A device that gave up on a baud rate switch announces itself again at the default rate
+      const negotiation = this.baudNegotiations.get(deviceName);
+      if (negotiation) {
+        if (!negotiation.fellBack) this.recordBaudRateFailure(deviceInfo.portName, negotiation.baudRate);
+        this.clearBaudNegotiation(deviceName);
+      }
+
       if (!this.awaitingSettingsAck.get(deviceName)) {
-        let configMessage = '';
-        switch (deviceInfo.config.deviceType) {
-          case DeviceType.SORTER:
-            configMessage = this.buildSorterInitMessage(deviceInfo.config);
-            break;
-          case DeviceType.CONVEYOR_JETS:
-            configMessage = this.buildConveyorJetsInitMessage(deviceInfo.config);
-            break;
-          case DeviceType.HOPPER_FEEDER:
-            configMessage = this.buildHopperFeederInitMessage(deviceInfo.config);
-            break;
-        }
-        if (configMessage) {
-          this.sendCommand(deviceInfo.deviceName, configMessage);
-          this.awaitingSettingsAck.set(deviceName, true);
-          // Set up timeout for ack
-          const timeout = setTimeout(() => {
-            if (this.awaitingSettingsAck.get(deviceName)) {
-              console.warn(
-                `\x1b[33m[${deviceName}] Settings ack timeout. No acknowledgment received after sending settings.\x1b[0m`,
-              );
-              this.socketManager.emitComponentStatusUpdate(
-                deviceName,
-                ComponentStatus.ERROR,
-                'Settings ack timeout. No acknowledgment received.',
-              );
-              // Optionally: retry sending settings or alert user here
-              // For now, just log and mark as error
-              this.awaitingSettingsAck.delete(deviceName);
-            }
-          }, this.SETTINGS_ACK_TIMEOUT_MS);
-          this.settingsAckTimeouts.set(deviceName, timeout);
+        if (!this.startBaudNegotiation(deviceInfo)) {
+          this.sendDeviceSettings(deviceInfo);
         }
       } else {
         console.log(`\x1b[33m[${deviceName}] Already awaiting settings ack, ignoring repeated 'Ready'.\x1b[0m`);
@@ -458,6 +790,18 @@ export class DeviceManager extends BaseComponent {
       return;
     }
 
+    // Handle baud rate negotiation
+    const baudMatch = /^Baud: (\d+)$/.exec(data.trim());
+    if (baudMatch) {
+      this.handleBaudRateSwitch(deviceInfo, Number(baudMatch[1]));
+      return;
+    }
+
+    if (data.trim() === 'Baud OK') {
+      this.handleBaudRateConfirmed(deviceInfo);
+      return;
+    }
+
     // Handle settings acknowledgment
     if (data.trim() === 'Settings updated') {
       if (this.awaitingSettingsAck.get(deviceName)) {
@@ -469,12 +813,44 @@ export class DeviceManager extends BaseComponent {
         }
         this.socketManager.emitComponentStatusUpdate(deviceName, ComponentStatus.READY, null);
         console.log(`\x1b[32m[${deviceName}] Settings acknowledged. Device is READY.\x1b[0m`);
+        if (this.settingsManager.getSettings()?.firmwareDebugLogging) {
+          this.sendCommand(deviceName, `${ArduinoCommands.LOG_LEVEL}${this.LOG_ALL_SUBSYSTEMS},${this.LOG_LEVEL_DEBUG}`);
+        }
+        if (deviceName === DeviceName.CONVEYOR_JETS) {
+          this.sendConveyorRuntimeSettings();
+        } else if (deviceName === DeviceName.HOPPER_FEEDER) {
+          this.sendFeederRuntimeSettings();
+        } else if (deviceName.startsWith('sorter_')) {
+          this.sendSorterBinLayout(deviceName);
+        }
+        this.deviceReadyCallbacks.forEach((callback) => callback(deviceName));
+        // Upgrade to the binary framed protocol once the device is configured
+        if (this.settingsManager.getSettings()?.binarySerialProtocol && !this.isBinaryProtocol(deviceName)) {
+          this.sendCommand(deviceName, ArduinoCommands.PROTOCOL_MODE, 1);
+        }
       } else {
         console.log(`\x1b[33m[${deviceName}] Received settings ack, but was not awaiting it.\x1b[0m`);
       }
       return;
     }
 
+    if (data.startsWith('AT:')) {
+      this.handleAutotuneResult(deviceName, data);
+      return;
+    }
+
+    // Handle speed settling reports from the conveyor, 'ST:<TARGET_RPM>,<SETTLE_MS>' (-1 = did not settle)
+    const settleMatch = /^ST:(\d+),(-?\d+)$/.exec(data.trim());
+    if (settleMatch) {
+      const [, targetRPM, settleMs] = settleMatch;
+      if (Number(settleMs) < 0) {
+        console.warn(`\x1b[33m[${deviceName}] Conveyor did not settle at ${targetRPM} RPM.\x1b[0m`);
+      } else {
+        console.log(`\x1b[32m[${deviceName}] Conveyor settled at ${targetRPM} RPM in ${settleMs} ms.\x1b[0m`);
+      }
+      return;
+    }
+
     // Handle error messages from device
     if (data.trim().startsWith('Error:')) {
       console.error(`\x1b[31m[${deviceName}] Device reported error: ${data.trim()}\x1b[0m`);
@@ -497,15 +873,369 @@ export class DeviceManager extends BaseComponent {
     }
 
     const message = data !== undefined ? `${command}${data}` : command;
-    const formattedMessage = `<${message}>`;
+    this.writeMessage(deviceInfo, message);
+  }
 
-    console.log(`\x1b[36m[TX -> ${deviceName}]\x1b[0m Sending command: ${formattedMessage}`);
-    deviceInfo.device.write(formattedMessage, (err: Error | null | undefined) => {
+  // Write a message in the device's current protocol. Returns the number of bytes sent.
+  private writeMessage(deviceInfo: DeviceInfo, message: string, log: boolean = true): number {
+    const { deviceName } = deviceInfo;
+    let payload: Buffer | string;
+
+    if (this.isBinaryProtocol(deviceName)) {
+      const seq = this.frameSeqs.get(deviceName) ?? 0;
+      this.frameSeqs.set(deviceName, (seq + 1) & 0xff);
+      payload = encodeCommandFrame(message, seq);
+      // Clock sync pings are answered with a pong frame rather than an ACK
+      if (message[0] !== ArduinoCommands.TIME_SYNC) {
+        this.trackPendingAck(deviceName, seq, message);
+      }
+      if (log) console.log(`\x1b[36m[TX -> ${deviceName}]\x1b[0m Sending frame #${seq}: ${message}`);
+    } else {
+      payload = `<${message}>`;
+      if (log) console.log(`\x1b[36m[TX -> ${deviceName}]\x1b[0m Sending command: ${payload}`);
+    }
+
+    deviceInfo.device.write(payload, (err: Error | null | undefined) => {
       if (err) {
         console.error(`\x1b[33mError sending message to ${deviceName}:\x1b[0m`, err);
         this.socketManager.emitComponentStatusUpdate(deviceName, ComponentStatus.ERROR, err.message);
       }
     });
+    return payload.length;
+  }
+
+  private isBinaryProtocol(deviceName: DeviceName): boolean {
+    return this.frameParsers.get(deviceName)?.isFramingEnabled() ?? false;
+  }
+
+  private trackPendingAck(deviceName: DeviceName, seq: number, message: string): void {
+    let pending = this.pendingAcks.get(deviceName);
+    if (!pending) {
+      pending = new Map();
+      this.pendingAcks.set(deviceName, pending);
+    }
+    const previous = pending.get(seq);
+    if (previous) clearTimeout(previous.timeout);
+
+    const timeout = setTimeout(() => {
+      pending?.delete(seq);
+      console.warn(`\x1b[33m[${deviceName}] No ACK for frame #${seq} (${message}).\x1b[0m`);
+    }, this.FRAME_ACK_TIMEOUT_MS);
+    pending.set(seq, { message, timeout });
+  }
+
+  private resolvePendingAck(deviceName: DeviceName, seq: number): PendingAck | undefined {
+    const pendingAck = this.pendingAcks.get(deviceName)?.get(seq);
+    if (pendingAck) {
+      clearTimeout(pendingAck.timeout);
+      this.pendingAcks.get(deviceName)?.delete(seq);
+    }
+    return pendingAck;
+  }
+
+  private handleDeviceFrame(deviceName: DeviceName, frame: SerialFrame): void {
+    const receivedAt = hostNow();
+
+    switch (String.fromCharCode(frame.opcode)) {
+      case 'T': {
+        const clock = this.clocks.get(deviceName);
+        if (clock && frame.payload.length === 8) {
+          this.applyClockSyncPong(
+            deviceName,
+            clock,
+            frame.payload.readUInt32LE(0),
+            frame.payload.readUInt32LE(4),
+            receivedAt,
+            frame.length,
+          );
+        }
+        return;
+      }
+      case 'O': {
+        if (frame.payload.length === 8) {
+          this.handleOdometrySample(deviceName, frame.payload.readUInt32LE(0), frame.payload.readUInt32LE(4));
+        }
+        return;
+      }
+      case 'D': {
+        if (frame.payload.length === 8 || frame.payload.length === 16) {
+          this.handleMoveTime(
+            deviceName,
+            frame.payload.readUInt16LE(0),
+            frame.payload.readUInt16LE(2),
+            frame.payload.readUInt32LE(4),
+            frame.payload.length === 16
+              ? { x: frame.payload.readUInt32LE(8), y: frame.payload.readUInt32LE(12) }
+              : undefined,
+          );
+        }
+        return;
+      }
+      case 'M': {
+        const moveId = frame.payload.length >= 4 ? ` (move #${frame.payload.readUInt16LE(2)})` : '';
+        console.log(`\x1b[35m[RX <- ${deviceName}]\x1b[0m Move complete: ${frame.payload.readUInt16LE(0)}${moveId}`);
+        return;
+      }
+    }
+
+    if (frame.opcode === FRAME_OP_ACK) {
+      this.resolvePendingAck(deviceName, frame.seq);
+      return;
+    }
+
+    if (frame.opcode === FRAME_OP_NAK) {
+      const pendingAck = this.resolvePendingAck(deviceName, frame.seq);
+      const reason = FRAME_NAK_REASONS[frame.payload[1]] ?? `reason ${frame.payload[1]}`;
+      console.error(
+        `\x1b[31m[${deviceName}] Frame #${frame.seq} (${pendingAck?.message ?? String.fromCharCode(frame.payload[0])}) rejected: ${reason}\x1b[0m`,
+      );
+      return;
+    }
+
+    console.warn(`\x1b[33m[${deviceName}] Unhandled frame opcode 0x${frame.opcode.toString(16)}\x1b[0m`);
+  }
+
+  private clearLinkState(deviceName: DeviceName): void {
+    this.clearBaudNegotiation(deviceName);
+    this.clocks.delete(deviceName);
+    this.frameParsers.delete(deviceName);
+    this.frameSeqs.delete(deviceName);
+    this.pendingAcks.get(deviceName)?.forEach((pendingAck) => clearTimeout(pendingAck.timeout));
+    this.pendingAcks.delete(deviceName);
+  }
+
+  public getDeviceClock(deviceName: DeviceName): DeviceClock | undefined {
+    return this.clocks.get(deviceName);
+  }
+
+  // --- Clock Sync Methods ---
+  private startClockSync(): void {
+    if (this.clockSyncTimer) {
+      clearInterval(this.clockSyncTimer);
+    }
+    this.clockSyncTimer = setInterval(() => {
+      const now = hostNow();
+      for (const [deviceName, clock] of this.clocks) {
+        const deviceInfo = this.devices.get(deviceName);
+        if (!deviceInfo || !deviceInfo.device.isOpen || !clock.isPingDue(now)) continue;
+        // Pings sent while the two ends may run at different rates would only be garbled
+        if (this.baudNegotiations.has(deviceName)) continue;
+        // Written without logging to keep pings out of the TX log
+        const seq = clock.nextPingSeq();
+        const bytes = this.writeMessage(deviceInfo, `${ArduinoCommands.TIME_SYNC}${seq}`, false);
+        clock.recordPingSent(seq, bytes);
+      }
+    }, this.CLOCK_SYNC_TICK_MS);
+  }
+
+  private handleClockSyncResponse(deviceName: DeviceName, data: string, receivedAt: number): void {
+    const clock = this.clocks.get(deviceName);
+    const match = /^T:(\d+),(\d+)$/.exec(data.trim());
+    if (!clock || !match) return;
+
+    // The parser strips the '\r\n' delimiter, which was still part of the transfer
+    this.applyClockSyncPong(deviceName, clock, Number(match[1]), Number(match[2]), receivedAt, data.length + 2);
+  }
+
+  private applyClockSyncPong(
+    deviceName: DeviceName,
+    clock: DeviceClock,
+    seq: number,
+    deviceMicros: number,
+    receivedAt: number,
+    rxBytes: number,
+  ): void {
+    const wasSynced = clock.isSynced();
+    clock.handlePong(seq, deviceMicros, receivedAt, rxBytes);
+    if (!wasSynced && clock.isSynced()) {
+      const { offsetUs, latencyMs } = clock.getStats();
+      console.log(
+        `\x1b[32m[${deviceName}] Clock synchronized (offset ${Math.round(offsetUs)}us, latency ${latencyMs.toFixed(2)}ms).\x1b[0m`,
+      );
+    }
+  }
+
+  // --- Conveyor Odometry Methods ---
+  public registerOdometryCallback(callback: OdometryCallback): void {
+    this.odometryCallbacks.push(callback);
+  }
+
+  public unregisterOdometryCallback(callback: OdometryCallback): void {
+    this.odometryCallbacks = this.odometryCallbacks.filter((cb) => cb !== callback);
+  }
+
+  // Conveyor settings that are not part of the 's' message and survive a settings update on the device
+  private sendConveyorRuntimeSettings(): void {
+    const settings = this.settingsManager.getSettings();
+    if (!settings || !this.devices.has(DeviceName.CONVEYOR_JETS)) return;
+    if (settings.conveyorFeedforwardPwm.length === this.FEEDFORWARD_POINTS) {
+      this.sendCommand(
+        DeviceName.CONVEYOR_JETS,
+        `${ArduinoCommands.FEEDFORWARD_TABLE}${settings.conveyorFeedforwardPwm.join(',')}`,
+      );
+    }
+    this.sendCommand(DeviceName.CONVEYOR_JETS, ArduinoCommands.ODOMETRY_INTERVAL, settings.conveyorOdometryIntervalMs);
+  }
+
+  private sendFeederRuntimeSettings(): void {
+    const settings = this.settingsManager.getSettings();
+    if (!settings || !this.devices.has(DeviceName.HOPPER_FEEDER)) return;
+    this.sendCommand(
+      DeviceName.HOPPER_FEEDER,
+      `${ArduinoCommands.DISTANCE_SENSOR_SETUP}${this.FILL_SENSOR},${settings.hopperFillSensorAddress}`,
+    );
+    const policyThreshold =
+      settings.hopperCyclePolicy === 'starvation'
+        ? settings.hopperStarvationMs
+        : settings.hopperCyclePolicy === 'fillLevel'
+          ? settings.hopperFillThreshold
+          : 0;
+    this.sendCommand(
+      DeviceName.HOPPER_FEEDER,
+      `${ArduinoCommands.HOPPER_POLICY}${hopperCyclePolicies.indexOf(settings.hopperCyclePolicy)},` +
+        `${policyThreshold},${settings.hopperMinCycleIntervalMs}`,
+    );
+    const hopperProfile = [
+      settings.hopperStrokeSteps,
+      settings.hopperDownSpeedUs,
+      settings.hopperDownAcceleration,
+      settings.hopperUpSpeedUs,
+      settings.hopperUpAcceleration,
+      settings.hopperBottomDwellMs,
+      settings.hopperLoadedStrokeSteps,
+    ];
+    this.sendCommand(DeviceName.HOPPER_FEEDER, `${ArduinoCommands.HOPPER_PROFILE}${hopperProfile.join(',')}`);
+    this.updateFeederTargetRate(settings.feederTargetPartsPerMinute);
+  }
+
+  // The bin layout is stored in the sorter's EEPROM, sending it on every handshake keeps both sides in step
+  private sendSorterBinLayout(deviceName: DeviceName): void {
+    const sorter = this.settingsManager.getSettings()?.sorters[Number(deviceName.slice('sorter_'.length))];
+    if (!sorter) return;
+    if (!isValidBinLayout(sorter.binLayout, sorter.gridDimension)) {
+      if (sorter.binLayout.length > 0) {
+        console.warn(`\x1b[33m[${deviceName}] Ignoring invalid bin layout, bins follow the grid order.\x1b[0m`);
+      }
+      this.sendCommand(deviceName, ArduinoCommands.COMMIT_BIN_MAP, 0);
+      return;
+    }
+    for (let start = 0; start < sorter.binLayout.length; start += this.BIN_MAP_CHUNK) {
+      const chunk = sorter.binLayout.slice(start, start + this.BIN_MAP_CHUNK);
+      this.sendCommand(deviceName, `${ArduinoCommands.BIN_MAP}${start + 1},${chunk.join(',')}`);
+    }
+    this.sendCommand(deviceName, ArduinoCommands.COMMIT_BIN_MAP, 1);
+  }
+
+  // 'AT:<KP_X100>,<KI_X100>,<KD_X100>,<PWM_0>,...,<PWM_5>' or 'AT:FAIL,<reason>'
+  private async handleAutotuneResult(deviceName: DeviceName, data: string): Promise<void> {
+    const result = data.trim().slice(3);
+    if (result.startsWith('FAIL')) {
+      console.warn(`\x1b[33m[${deviceName}] Conveyor autotune failed: ${result.slice(5)}\x1b[0m`);
+      return;
+    }
+    const values = result.split(',').map(Number);
+    if (values.length !== 3 + this.FEEDFORWARD_POINTS || values.some((value) => !Number.isFinite(value))) {
+      console.error(`\x1b[31m[${deviceName}] Invalid autotune result: ${data.trim()}\x1b[0m`);
+      return;
+    }
+    const [kp, ki, kd, ...feedforward] = values;
+    console.log(
+      `\x1b[32m[${deviceName}] Conveyor autotune: Kp ${kp / 100}, Ki ${ki / 100}, Kd ${kd / 100}, feedforward ${feedforward.join(',')}\x1b[0m`,
+    );
+    try {
+      await this.settingsManager.updateSettings({
+        conveyorKp: kp / 100,
+        conveyorKi: ki / 100,
+        conveyorKd: kd / 100,
+        conveyorFeedforwardPwm: feedforward,
+      });
+    } catch (error) {
+      console.error('\x1b[33mError saving autotune result:\x1b[0m', error);
+    }
+  }
+
+  private handleOdometrySample(deviceName: DeviceName, deviceMicros: number, position: number): void {
+    if (deviceName !== DeviceName.CONVEYOR_JETS) return;
+    // Samples can only be placed on the host timeline once the clocks are synchronized
+    const clock = this.clocks.get(deviceName);
+    if (!clock || !clock.isSynced()) return;
+
+    const hostMs = clock.deviceMicrosToHost(deviceMicros);
+    this.odometryCallbacks.forEach((callback) => callback(hostMs, position));
+  }
+
+  // --- Sorter Move Time Methods ---
+  public registerMoveTimeCallback(callback: MoveTimeCallback): void {
+    this.moveTimeCallbacks.push(callback);
+  }
+
+  public unregisterMoveTimeCallback(callback: MoveTimeCallback): void {
+    this.moveTimeCallbacks = this.moveTimeCallbacks.filter((cb) => cb !== callback);
+  }
+
+  public registerMovePredictionCallback(callback: MovePredictionCallback): void {
+    this.movePredictionCallbacks.push(callback);
+  }
+
+  public unregisterMovePredictionCallback(callback: MovePredictionCallback): void {
+    this.movePredictionCallbacks = this.movePredictionCallbacks.filter((cb) => cb !== callback);
+  }
+
+  public registerSorterParkCallback(callback: SorterParkCallback): void {
+    this.sorterParkCallbacks.push(callback);
+  }
+
+  public unregisterSorterParkCallback(callback: SorterParkCallback): void {
+    this.sorterParkCallbacks = this.sorterParkCallbacks.filter((cb) => cb !== callback);
+  }
+
+  public registerSorterDriftCallback(callback: SorterDriftCallback): void {
+    this.sorterDriftCallbacks.push(callback);
+  }
+
+  public unregisterSorterDriftCallback(callback: SorterDriftCallback): void {
+    this.sorterDriftCallbacks = this.sorterDriftCallbacks.filter((cb) => cb !== callback);
+  }
+
+  public registerFeederPartCallback(callback: FeederPartCallback): void {
+    this.feederPartCallbacks.push(callback);
+  }
+
+  public unregisterFeederPartCallback(callback: FeederPartCallback): void {
+    this.feederPartCallbacks = this.feederPartCallbacks.filter((cb) => cb !== callback);
+  }
+
+  public registerDeviceReadyCallback(callback: DeviceReadyCallback): void {
+    this.deviceReadyCallbacks.push(callback);
+  }
+
+  public unregisterDeviceReadyCallback(callback: DeviceReadyCallback): void {
+    this.deviceReadyCallbacks = this.deviceReadyCallbacks.filter((cb) => cb !== callback);
+  }
+
+  private handleMoveTime(
+    deviceName: DeviceName,
+    fromBin: number,
+    toBin: number,
+    durationUs: number,
+    axisUs?: { x: number; y: number },
+  ): void {
+    const axisMs = axisUs && { x: axisUs.x / 1000, y: axisUs.y / 1000 };
+    this.moveTimeCallbacks.forEach((callback) => callback(deviceName, fromBin, toBin, durationUs / 1000, axisMs));
+  }
+
+  private handleFeederPartEvent(
+    deviceName: DeviceName,
+    event: 'arrived' | 'left',
+    deviceMicros: number,
+    receivedAt: number,
+    dwellMs?: number,
+  ): void {
+    if (deviceName !== DeviceName.HOPPER_FEEDER) return;
+    // Before the clocks are synchronized the receive time is the best estimate
+    const clock = this.clocks.get(deviceName);
+    const hostMs = clock?.isSynced() ? clock.deviceMicrosToHost(deviceMicros) : receivedAt;
+    this.feederPartCallbacks.forEach((callback) => callback(event, hostMs, dwellMs));
   }
 
   public updateFeederPauseTime(pauseTime: number): void {
@@ -524,16 +1254,14 @@ export class DeviceManager extends BaseComponent {
       safePauseTime = 10; // Enforce a minimum of 10ms
     }
 
-    const message = `p,${safePauseTime}`;
-    const formattedMessage = `<${message}>`;
+    this.writeMessage(deviceInfo, `p,${safePauseTime}`);
+  }
 
-    console.log(`\x1b[36m[TX -> ${DeviceName.HOPPER_FEEDER}]\x1b[0m Sending command: ${formattedMessage}`);
-    deviceInfo.device.write(formattedMessage, (err: Error | null | undefined) => {
-      if (err) {
-        console.error('\x1b[33mError sending pause time update to hopper feeder:\x1b[0m', err);
-        this.socketManager.emitComponentStatusUpdate(DeviceName.HOPPER_FEEDER, ComponentStatus.ERROR, err.message);
-      }
-    });
+  // Parts per minute the feeder regulates to from its part sensor, 0 = fixed speed and pause time
+  public updateFeederTargetRate(partsPerMinute: number): void {
+    if (!this.devices.has(DeviceName.HOPPER_FEEDER)) return;
+    const rate = Number.isFinite(partsPerMinute) ? Math.max(Math.round(partsPerMinute), 0) : 0;
+    this.sendCommand(DeviceName.HOPPER_FEEDER, ArduinoCommands.FEEDER_TARGET_RATE, rate);
   }
 
   protected notifyStatusChange(): void {
@@ -578,6 +1306,7 @@ export class DeviceManager extends BaseComponent {
         if (configMessage) {
           this.sendCommand(DeviceName.HOPPER_FEEDER, configMessage);
         }
+        this.sendFeederRuntimeSettings();
       }
 
       // Update sorter settings if connected
@@ -598,11 +1327,20 @@ export class DeviceManager extends BaseComponent {
             HOMING_SPEED: sorter.homingSpeed,
             SPEED: sorter.speed,
             ROW_MAJOR_ORDER: sorter.rowMajorOrder,
+            HOMING_FAST_SPEED: sorter.homingFastSpeed,
+            Y_ACCELERATION: sorter.yAcceleration,
+            Y_SPEED: sorter.ySpeed,
+            SYNCHRONIZED_MOVES: sorter.synchronizedMoves,
+            S_CURVE_STEPS: sorter.sCurveSteps,
           };
           this.devices.set(deviceName, { ...sorterDevice, config });
           const configMessage = this.buildSorterInitMessage(config);
           if (configMessage) {
             this.sendCommand(deviceName, configMessage);
+            // The settings reload the bin map from EEPROM, send the current layout after them
+            this.sendSorterBinLayout(deviceName);
+            // They also reset runtime state such as parking and position checks
+            this.deviceReadyCallbacks.forEach((callback) => callback(deviceName));
           }
         }
       }
@@ -620,6 +1358,7 @@ export class DeviceManager extends BaseComponent {
         if (configMessage) {
           this.sendCommand(DeviceName.CONVEYOR_JETS, configMessage);
         }
+        this.sendConveyorRuntimeSettings();
       }
     } catch (error) {
       console.error('\x1b[33mError updating device settings:\x1b[0m', error);
@@ -716,6 +1455,11 @@ export class DeviceManager extends BaseComponent {
             HOMING_SPEED: sorterSettings.homingSpeed,
             SPEED: sorterSettings.speed,
             ROW_MAJOR_ORDER: sorterSettings.rowMajorOrder,
+            HOMING_FAST_SPEED: sorterSettings.homingFastSpeed,
+            Y_ACCELERATION: sorterSettings.yAcceleration,
+            Y_SPEED: sorterSettings.ySpeed,
+            SYNCHRONIZED_MOVES: sorterSettings.synchronizedMoves,
+            S_CURVE_STEPS: sorterSettings.sCurveSteps,
           },
         });
       }
@@ -0,0 +1,177 @@
+import { Transform, TransformCallback } from 'stream';
+
+// Binary framed serial protocol, mirrors arduino_code/serial_link.h
+// Frame: [SYNC 0xA5][LEN][OPCODE][SEQ][PAYLOAD ...][CRC8], LEN counts OPCODE + SEQ + PAYLOAD
+export const FRAME_SYNC = 0xa5;
+export const FRAME_MAX_PAYLOAD = 64;
+export const FRAME_OP_ACK = 0x06;
+export const FRAME_OP_NAK = 0x15;
+
+export const FRAME_NAK_REASONS: Record<number, string> = {
+  1: 'CRC error',
+  2: 'invalid payload',
+  3: 'busy',
+  4: 'queue full',
+};
+
+// Lines the device prints when it switches protocol. A reset device always boots in ASCII mode.
+const BINARY_MODE_LINE = 'Binary mode';
+const ASCII_MODE_LINES = ['ASCII mode', 'Ready'];
+
+type FieldType = 'u8' | 'u16' | 'u32';
+
+const FIELD_SIZES: Record<FieldType, number> = { u8: 1, u16: 2, u32: 4 };
+
+// Commands with a fixed binary payload. Any other command is sent with its ASCII arguments as payload.
+const COMMAND_LAYOUTS: Record<string, FieldType[]> = {
+  t: ['u32'],
+  j: ['u8'],
+  J: ['u8', 'u32'],
+  X: ['u8', 'u32'],
+  K: ['u8', 'u32'],
+  k: ['u8', 'u32'],
+  c: ['u16'],
+  m: ['u16'],
+  Q: ['u16', 'u16', 'u32'],
+  x: ['u16'],
+  p: ['u16'],
+  P: ['u8'],
+  e: ['u16'],
+};
+
+export interface SerialFrame {
+  opcode: number;
+  seq: number;
+  payload: Buffer;
+  length: number; // total bytes on the wire
+}
+
+export type SerialPacket = { type: 'line'; text: string } | { type: 'frame'; frame: SerialFrame };
+
+export const crc8 = (data: Buffer): number => {
+  let crc = 0;
+  for (const byte of data) {
+    crc ^= byte;
+    for (let i = 0; i < 8; i++) {
+      crc = crc & 0x80 ? ((crc << 1) ^ 0x07) & 0xff : (crc << 1) & 0xff;
+    }
+  }
+  return crc;
+};
+
+export const encodeFrame = (opcode: number, seq: number, payload: Buffer): Buffer => {
+  if (payload.length > FRAME_MAX_PAYLOAD) {
+    throw new Error(`Frame payload of ${payload.length} bytes exceeds ${FRAME_MAX_PAYLOAD}`);
+  }
+  const body = Buffer.concat([Buffer.from([payload.length + 2, opcode, seq & 0xff]), payload]);
+  return Buffer.concat([Buffer.from([FRAME_SYNC]), body, Buffer.from([crc8(body)])]);
+};
+
+// Convert a legacy ASCII command (without '<' '>') into a frame, e.g. 'J2,123456' or 's,1,2,3'
+export const encodeCommandFrame = (message: string, seq: number): Buffer => {
+  const command = message[0];
+  const args = message.slice(1);
+  const layout = COMMAND_LAYOUTS[command];
+  const values = args
+    .split(',')
+    .filter((value) => value !== '')
+    .map(Number);
+
+  if (layout && values.length === layout.length && values.every((value) => Number.isFinite(value))) {
+    const payload = Buffer.alloc(layout.reduce((size, field) => size + FIELD_SIZES[field], 0));
+    let offset = 0;
+    layout.forEach((field, index) => {
+      const value = Math.round(values[index]);
+      if (field === 'u8') payload.writeUInt8(value & 0xff, offset);
+      if (field === 'u16') payload.writeUInt16LE(value & 0xffff, offset);
+      if (field === 'u32') payload.writeUInt32LE(value >>> 0, offset);
+      offset += FIELD_SIZES[field];
+    });
+    return encodeFrame(command.charCodeAt(0), seq, payload);
+  }
+
+  return encodeFrame(command.charCodeAt(0), seq, Buffer.from(args, 'latin1'));
+};
+
+/**
+ * Splits the device byte stream into newline-terminated text lines and binary frames.
+ * Framing is only recognized after the device announces binary mode, so noise on a legacy
+ * ASCII connection can never be mistaken for a frame.
+ */
+export class SerialFrameParser extends Transform {
+  private static readonly MAX_LINE_LENGTH = 1024;
+  private buffer: Buffer = Buffer.alloc(0);
+  private framingEnabled = false;
+
+  constructor() {
+    super({ readableObjectMode: true });
+  }
+
+  public isFramingEnabled(): boolean {
+    return this.framingEnabled;
+  }
+
+  _transform(chunk: Buffer, _encoding: BufferEncoding, callback: TransformCallback): void {
+    this.buffer = Buffer.concat([this.buffer, chunk]);
+    this.drain();
+    callback();
+  }
+
+  private drain(): void {
+    while (this.buffer.length > 0) {
+      const syncIndex = this.framingEnabled ? this.buffer.indexOf(FRAME_SYNC) : -1;
+      const newlineIndex = this.buffer.indexOf('\r\n');
+
+      if (syncIndex !== -1 && (newlineIndex === -1 || syncIndex < newlineIndex)) {
+        // Anything before the sync byte is a fragment that can't be completed anymore
+        if (syncIndex > 0) {
+          this.emitLine(this.buffer.subarray(0, syncIndex).toString('latin1'));
+          this.buffer = this.buffer.subarray(syncIndex);
+        }
+        if (this.buffer.length < 2) return;
+        const length = this.buffer[1];
+        if (length < 2 || length > FRAME_MAX_PAYLOAD + 2) {
+          this.buffer = this.buffer.subarray(1); // not a real frame start, resync
+          continue;
+        }
+        const frameLength = length + 3;
+        if (this.buffer.length < frameLength) return;
+
+        const body = this.buffer.subarray(1, length + 2);
+        if (crc8(body) !== this.buffer[length + 2]) {
+          this.buffer = this.buffer.subarray(1);
+          continue;
+        }
+        const frame: SerialFrame = {
+          opcode: body[1],
+          seq: body[2],
+          payload: Buffer.from(body.subarray(3)),
+          length: frameLength,
+        };
+        this.buffer = this.buffer.subarray(frameLength);
+        this.push({ type: 'frame', frame } as SerialPacket);
+        continue;
+      }
+
+      if (newlineIndex !== -1) {
+        const line = this.buffer.subarray(0, newlineIndex).toString('latin1');
+        this.buffer = this.buffer.subarray(newlineIndex + 2);
+        this.emitLine(line);
+        continue;
+      }
+
+      if (this.buffer.length > SerialFrameParser.MAX_LINE_LENGTH) {
+        this.emitLine(this.buffer.toString('latin1'));
+        this.buffer = Buffer.alloc(0);
+      }
+      return;
+    }
+  }
+
+  private emitLine(text: string): void {
+    // Follow the device's protocol switches before parsing any further bytes
+    if (text.trim() === BINARY_MODE_LINE) this.framingEnabled = true;
+    if (ASCII_MODE_LINES.includes(text.trim())) this.framingEnabled = false;
+    this.push({ type: 'line', text } as SerialPacket);
+  }
+}
@@ -7,16 +7,25 @@ export interface SettingsManagerConfig extends ComponentConfig {
   socketManager: SocketManager;
 }
 
+// Baud rates negotiated on one serial port, null = no stable rate yet
+export type SerialLinkState = {
+  stableBaudRate: number | null;
+  failedBaudRates: number[];
+};
+
 export class SettingsManager extends BaseComponent {
   private settings: SettingsType | null = null;
   private socketManager: SocketManager;
   private settingsRef: FirebaseFirestore.DocumentReference;
+  // Kept apart from the settings so saving it doesn't resend the settings to every device
+  private serialLinksRef: FirebaseFirestore.DocumentReference;
   private settingsUpdateCallbacks: ((settings: SettingsType) => Promise<void>)[] = [];
 
   constructor(socketManager: SocketManager) {
     super('SettingsManager');
     this.socketManager = socketManager;
     this.settingsRef = adminDb.collection('settings').doc('dev-user');
+    this.serialLinksRef = adminDb.collection('serialLinks').doc('dev-user');
   }
 
   public getSettings(): SettingsType | null {
@@ -31,6 +40,21 @@ export class SettingsManager extends BaseComponent {
     this.settingsUpdateCallbacks = this.settingsUpdateCallbacks.filter((cb) => cb !== callback);
   }
 
+  // Merge a partial update into the stored settings. Callbacks run once the snapshot listener sees the change.
+  public async updateSettings(update: Partial<SettingsType>): Promise<void> {
+    await this.settingsRef.set(update, { merge: true });
+  }
+
+  // Serial link state keyed by serial port
+  public async getSerialLinkStates(): Promise<Record<string, SerialLinkState>> {
+    const snapshot = await this.serialLinksRef.get();
+    return (snapshot.data() as Record<string, SerialLinkState> | undefined) ?? {};
+  }
+
+  public async saveSerialLinkState(portName: string, state: SerialLinkState): Promise<void> {
+    await this.serialLinksRef.set({ [portName]: state }, { merge: true });
+  }
+
   private async notifySettingsUpdateCallbacks(settings: SettingsType): Promise<void> {
     for (const callback of this.settingsUpdateCallbacks) {
       try {
@@ -13,6 +13,8 @@ export interface SocketManagerConfig extends ComponentConfig {
   onFireJet: (data: { sorter: number }) => void;
   onListSerialPorts: () => Promise<void>;
   onResetSortProcess: () => void;
+  onAutotuneConveyor: () => void;
+  onOptimizeBinLayout: () => void;
   onUpdateFeederSettings: (data: {
     vibrationSpeed: number;
     stopDelay: number;
@@ -65,6 +67,8 @@ export class SocketManager extends BaseComponent {
     this.socket.on(FrontToBackEvents.FIRE_JET, this.handlers.onFireJet);
     this.socket.on(FrontToBackEvents.LIST_SERIAL_PORTS, this.handlers.onListSerialPorts);
     this.socket.on(FrontToBackEvents.RESET_SORT_PROCESS, this.handlers.onResetSortProcess);
+    this.socket.on(FrontToBackEvents.AUTOTUNE_CONVEYOR, this.handlers.onAutotuneConveyor);
+    this.socket.on(FrontToBackEvents.OPTIMIZE_BIN_LAYOUT, this.handlers.onOptimizeBinLayout);
     this.socket.on(FrontToBackEvents.UPDATE_FEEDER_SETTINGS, this.handlers.onUpdateFeederSettings);
 
     this.socket.on('disconnect', () => {
@@ -4,6 +4,24 @@ import { SocketManager } from './SocketManager';
 import { ArduinoCommands } from '../../types/arduinoCommands.type';
 import { SettingsManager } from './SettingsManager';
 import { DeviceName } from '../../types/deviceName.type';
+import { Part } from '../../types/part.type';
+import { SorterSettingsType } from '../../types/settings.type';
+import { AxisProfile, SorterTravelModel } from './SorterTravelModel';
+import { binGridPosition, isValidBinLayout, optimizeBinLayout } from './BinLayoutOptimizer';
+
+// How far ahead of its start time a move is handed to the sorter's move queue.
+// The sorter starts it by itself once the previous move is complete and the start time has come.
+const MOVE_QUEUE_LEAD_MS = 1000;
+const MOVE_PREDICTION_TIMEOUT_MS = 1000;
+const MIN_PARTS_FOR_BIN_LAYOUT = 50; // bin statistics needed before the layout is optimized
+const PARK_BIN_UPDATE_PARTS = 10; // parts between re-evaluations of the park bin
+const MIN_VERIFY_IDLE_MS = 1000; // position checks wait at least this long after a move for the part to fall through
+
+interface PendingPrediction {
+  resolve: (durationMs: number) => void;
+  reject: (error: Error) => void;
+  timeout: NodeJS.Timeout;
+}
 
 export interface SorterManagerConfig extends ComponentConfig {
   deviceManager: DeviceManager;
@@ -17,9 +35,19 @@ export class SorterManager extends BaseComponent {
   private settingsManager: SettingsManager;
   private sorterCount: number = 0;
   private gridDimensions: number[] = [];
-  private travelTimes: number[][] = [];
+  private travelModels: SorterTravelModel[] = [];
+  private travelModelKeys: string[] = [];
   private binPositions: { x: number; y: number }[][] = [];
   private currentPositions: number[] = [];
+  private nextMoveIds: number[] = [];
+  // Move time queries waiting for their 'MP:' answer, per sorter in the order they were sent
+  private pendingPredictions: PendingPrediction[][] = [];
+  // Logical bins of the parts sent to each sorter, input of the bin layout optimizer
+  private binVisits: number[][] = [];
+  private binTransitions: number[][][] = [];
+  private lastPartBins: (number | null)[] = [];
+  // Bin each sorter parks at when idle, as last sent to it (0 = off)
+  private parkBins: number[] = [];
 
   constructor(config: SorterManagerConfig) {
     super('SorterManager');
@@ -28,20 +56,124 @@ export class SorterManager extends BaseComponent {
     this.settingsManager = config.settingsManager;
   }
 
-  private generateBinPositions(gridDimensions: number[]): { x: number; y: number }[][] {
+  // Grid indices of every logical bin, after the sorter's bin layout like binToPosition() in sorter.cpp
+  private generateBinPositions(sorters: SorterSettingsType[]): { x: number; y: number }[][] {
     const binPositions: { x: number; y: number }[][] = [];
-    for (const gridDimension of gridDimensions) {
+    for (const { gridDimension, rowMajorOrder, binLayout } of sorters) {
+      const hasLayout = isValidBinLayout(binLayout, gridDimension);
       const positions = [{ x: 0, y: 0 }]; // position 0 is null because bin ids start at 1
-      for (let y = 0; y < gridDimension; y++) {
-        for (let x = 0; x < gridDimension; x++) {
-          positions.push({ x, y });
-        }
+      for (let bin = 1; bin <= gridDimension * gridDimension; bin++) {
+        positions.push(binGridPosition(hasLayout ? binLayout[bin - 1] : bin, gridDimension, rowMajorOrder));
       }
       binPositions.push(positions);
     }
     return binPositions;
   }
 
+  // Bin statistics are kept across settings updates as long as the grid size stays the same
+  private updateBinStatistics(sorters: SorterSettingsType[]): void {
+    sorters.forEach(({ gridDimension }, sorter) => {
+      const binCount = gridDimension * gridDimension;
+      if (this.binVisits[sorter]?.length === binCount) return;
+      this.binVisits[sorter] = new Array(binCount).fill(0);
+      this.binTransitions[sorter] = Array.from({ length: binCount }, () => new Array(binCount).fill(0));
+      this.lastPartBins[sorter] = null;
+    });
+  }
+
+  private recordPartBin(part: Part): void {
+    const { sorter, bin } = part;
+    const visits = this.binVisits[sorter];
+    if (part.binRecorded || !visits || bin < 1 || bin > visits.length) return;
+    part.binRecorded = true;
+    visits[bin - 1]++;
+    const previous = this.lastPartBins[sorter];
+    if (previous) this.binTransitions[sorter][previous - 1][bin - 1]++;
+    this.lastPartBins[sorter] = bin;
+
+    const partCount = visits.reduce((sum, count) => sum + count, 0);
+    if (partCount % PARK_BIN_UPDATE_PARTS === 0) this.updateParkBin(sorter);
+  }
+
+  // The park bin minimizes the expected travel to the next part's bin. Every bin counts once extra,
+  // so without statistics the sorter parks in the middle of the grid.
+  private findParkBin(sorter: number): number {
+    const positions = this.binPositions[sorter];
+    const visits = this.binVisits[sorter];
+    const model = this.travelModels[sorter];
+    let bestBin = 0;
+    let bestTime = Infinity;
+    for (let bin = 1; bin < positions.length; bin++) {
+      let time = 0;
+      for (let target = 1; target < positions.length; target++) {
+        const dx = positions[target].x - positions[bin].x;
+        const dy = positions[target].y - positions[bin].y;
+        time += ((visits?.[target - 1] ?? 0) + 1) * model.predict(dx, dy);
+      }
+      if (time < bestTime) {
+        bestTime = time;
+        bestBin = bin;
+      }
+    }
+    return bestBin;
+  }
+
+  private updateParkBin(sorter: number, force: boolean = false): void {
+    const settings = this.settingsManager.getSettings();
+    if (!settings || !this.binPositions[sorter]) return;
+    const parkBin = settings.sorterParkDelayMs > 0 ? this.findParkBin(sorter) : 0;
+    if (!force && parkBin === this.parkBins[sorter]) return;
+
+    const deviceName = DeviceName[`SORTER_${sorter}` as keyof typeof DeviceName];
+    try {
+      this.deviceManager.sendCommand(deviceName, `${ArduinoCommands.PARK}${settings.sorterParkDelayMs},${parkBin}`);
+      this.parkBins[sorter] = parkBin;
+    } catch (error) {
+      // The sorter is not connected, the park bin is sent once it is ready
+      this.parkBins[sorter] = 0;
+    }
+  }
+
+  // Position checks run while the sorter is idle, after the last part has surely fallen through the funnel
+  private sendPositionCheckSettings(sorter: number): void {
+    const settings = this.settingsManager.getSettings();
+    if (!settings) return;
+    const idleMs = Math.max(settings.sorterParkDelayMs, MIN_VERIFY_IDLE_MS);
+    const deviceName = DeviceName[`SORTER_${sorter}` as keyof typeof DeviceName];
+    try {
+      this.deviceManager.sendCommand(
+        deviceName,
+        `${ArduinoCommands.VERIFY_POSITION}${settings.sorterVerifyEveryMoves},${idleMs}`,
+      );
+    } catch (error) {
+      // The sorter is not connected, the settings are sent once it is ready
+    }
+  }
+
+  // Keep what a sorter's travel model learned unless its motion settings changed
+  private updateTravelModels(sorters: SorterSettingsType[]): void {
+    this.travelModels = sorters.map((sorter, index) => {
+      const key = JSON.stringify([
+        sorter.gridDimension,
+        sorter.xOffset,
+        sorter.yOffset,
+        sorter.xStepsToLast,
+        sorter.yStepsToLast,
+        sorter.acceleration,
+        sorter.speed,
+        sorter.yAcceleration,
+        sorter.ySpeed,
+        sorter.synchronizedMoves,
+        sorter.sCurveSteps,
+      ]);
+      const model = this.travelModels[index];
+      if (model && this.travelModelKeys[index] === key) return model;
+      this.travelModelKeys[index] = key;
+      return SorterTravelModel.fromSettings(sorter);
+    });
+    this.travelModelKeys.length = sorters.length;
+  }
+
   public async initialize(): Promise<void> {
     try {
       this.setStatus(ComponentStatus.INITIALIZING);
@@ -55,23 +187,18 @@ export class SorterManager extends BaseComponent {
       // Initialize from settings
       this.sorterCount = settings.sorters.length;
       this.gridDimensions = settings.sorters.map((sorter) => sorter.gridDimension);
-      this.travelTimes = [
-        [0, 828, 1166, 1429, 1655, 1846, 2022, 2184, 2333, 2400, 2466, 2533, 2600, 2666, 2733, 2800, 2866],
-        [
-          0, 767, 1088, 1331, 1538, 1721, 1886, 2036, 2177, 2310, 2448, 2585, 2522, 2545, 2726, 2861, 2667, 2734, 2870,
-          3006, 3009, 3144,
-        ],
-
-        [
-          0, 767, 1088, 1331, 1538, 1721, 1886, 2036, 2177, 2310, 2448, 2585, 2522, 2545, 2726, 2861, 2667, 2734, 2870,
-          3006, 3009, 3144, 3280, 3415, 3550, 3685, 3820, 3955, 4090,
-        ],
-        [0, 828, 1166, 1429, 1655, 1846, 2022, 2184, 2333, 2400, 2466, 2533, 2600, 2666, 2733, 2800, 2866, 2933, 3000],
-      ];
+      this.updateTravelModels(settings.sorters);
       this.currentPositions = new Array(this.sorterCount).fill(1); // 1 is the first bin
+      this.nextMoveIds = new Array(this.sorterCount).fill(1);
 
       // Generate bin positions and initialize sorters
-      this.binPositions = this.generateBinPositions(this.gridDimensions);
+      this.binPositions = this.generateBinPositions(settings.sorters);
+      this.updateBinStatistics(settings.sorters);
+      this.deviceManager.registerMoveTimeCallback(this.handleMoveTime);
+      this.deviceManager.registerMovePredictionCallback(this.handleMovePrediction);
+      this.deviceManager.registerSorterParkCallback(this.handleSorterPark);
+      this.deviceManager.registerSorterDriftCallback(this.handleSorterDrift);
+      this.deviceManager.registerDeviceReadyCallback(this.handleDeviceReady);
 
       // Register for settings updates
       this.settingsManager.registerSettingsUpdateCallback(this.reinitialize.bind(this));
@@ -89,6 +216,11 @@ export class SorterManager extends BaseComponent {
   public async deinitialize(): Promise<void> {
     // Unregister settings callback
     this.settingsManager.unregisterSettingsUpdateCallback(this.reinitialize.bind(this));
+    this.deviceManager.unregisterMoveTimeCallback(this.handleMoveTime);
+    this.deviceManager.unregisterMovePredictionCallback(this.handleMovePrediction);
+    this.deviceManager.unregisterSorterParkCallback(this.handleSorterPark);
+    this.deviceManager.unregisterSorterDriftCallback(this.handleSorterDrift);
+    this.deviceManager.unregisterDeviceReadyCallback(this.handleDeviceReady);
     this.currentPositions = [];
     this.setStatus(ComponentStatus.UNINITIALIZED);
   }
@@ -123,20 +255,191 @@ export class SorterManager extends BaseComponent {
     // if fromBin is not provided, use the current position of the sorter
     const confirmedFromBin = fromBin || this.currentPositions[sorter] || 1;
 
-    const { x: x1, y: y1 } = this.binPositions[sorter][toBin];
-    const { x: x2, y: y2 } = this.binPositions[sorter][confirmedFromBin];
-    const y = x2 - x1;
-    const x = y2 - y1;
-    const moveDist = Math.sqrt(x * x + y * y);
-    const closestTravelTimeIndex = Math.round(moveDist);
-    return this.travelTimes[sorter][closestTravelTimeIndex];
+    const { x: x1, y: y1 } = this.binPositions[sorter][confirmedFromBin];
+    const { x: x2, y: y2 } = this.binPositions[sorter][toBin];
+    return this.travelModels[sorter].predict(x2 - x1, y2 - y1);
   }
 
-  public scheduleSorterMove(sorter: number, bin: number, moveTime: number): NodeJS.Timeout {
-    const delay = moveTime - Date.now();
+  /**
+   * Travel time of a part's move when the sorter may have parked since the previous part.
+   *
+   * The sorter parks parkDelay after the previous move completed, which happens between that move's start and
+   * the end the previous part was planned for. A move that surely starts before parking uses the previous bin, one
+   * that surely starts after it uses the park bin. In between the move is started early, when parking could begin at
+   * the soonest: a queued move that is due keeps the sorter from parking, so it runs from the previous bin.
+   */
+  public getTravelTimeForPart({
+    sorter,
+    toBin,
+    moveEnd,
+    previous,
+  }: {
+    sorter: number;
+    toBin: number;
+    moveEnd: number; // time the move has to be finished by
+    previous?: { bin: number; moveTime: number; moveEnd: number };
+  }): number {
+    const fromPrevious = this.getTravelTimeBetweenBins({ sorter, fromBin: previous?.bin, toBin });
+    const parkBin = this.parkBins[sorter];
+    const parkDelay = this.settingsManager.getSettings()?.sorterParkDelayMs ?? 0;
+    if (!previous || !parkBin || parkDelay <= 0 || previous.bin === parkBin) return fromPrevious;
+
+    if (moveEnd - fromPrevious < previous.moveTime + parkDelay) return fromPrevious;
+    const parkEnd =
+      previous.moveEnd + parkDelay + this.getTravelTimeBetweenBins({ sorter, fromBin: previous.bin, toBin: parkBin });
+    const fromPark = this.getTravelTimeBetweenBins({ sorter, fromBin: parkBin, toBin });
+    if (moveEnd - fromPark >= parkEnd) return fromPark;
+    return moveEnd - (previous.moveTime + parkDelay);
+  }
+
+  private handleSorterPark = (deviceName: DeviceName, bin: number): void => {
+    const sorter = Number(/^sorter_(\d+)$/.exec(deviceName)?.[1] ?? NaN);
+    if (this.currentPositions[sorter] === undefined) return;
+    this.currentPositions[sorter] = bin;
+    this.socketManager.emitSorterPositionUpdate(sorter, bin);
+  };
+
+  private handleDeviceReady = (deviceName: DeviceName): void => {
+    const sorter = Number(/^sorter_(\d+)$/.exec(deviceName)?.[1] ?? NaN);
+    if (sorter >= 0 && sorter < this.sorterCount) {
+      this.updateParkBin(sorter, true);
+      this.sendPositionCheckSettings(sorter);
+    }
+  };
+
+  private handleSorterDrift = (deviceName: DeviceName, xDrift: number, yDrift: number): void => {
+    const message = `[${deviceName}] Position check: X drift ${xDrift} steps, Y drift ${yDrift} steps`;
+    if (xDrift !== 0 || yDrift !== 0) {
+      console.log(`\x1b[33m${message}, corrected.\x1b[0m`);
+    } else {
+      console.log(`\x1b[32m${message}.\x1b[0m`);
+    }
+  };
+
+  private handleMoveTime = (
+    deviceName: DeviceName,
+    fromBin: number,
+    toBin: number,
+    durationMs: number,
+    axisMs?: { x: number; y: number },
+  ): void => {
+    const sorter = Number(/^sorter_(\d+)$/.exec(deviceName)?.[1] ?? NaN);
+    const model = this.travelModels[sorter];
+    const from = this.binPositions[sorter]?.[fromBin];
+    const to = this.binPositions[sorter]?.[toBin];
+    if (!model || fromBin < 1 || toBin < 1 || !from || !to) return;
+
+    const wasFitted = model.isFitted();
+    model.addSample(to.x - from.x, to.y - from.y, durationMs, axisMs);
+    if (!wasFitted && model.isFitted()) {
+      const { x, y, overheadMs } = model.getProfiles();
+      const axis = ({ maxSpeed, acceleration }: AxisProfile) =>
+        `${(maxSpeed * 1000).toFixed(1)} bins/s, ${(acceleration * 1e6).toFixed(1)} bins/s²`;
+      console.log(
+        `\x1b[32m[${deviceName}] Travel model fitted: X ${axis(x)}, Y ${axis(y)}, overhead ${overheadMs.toFixed(0)} ms.\x1b[0m`,
+      );
+    }
+  };
+
+  // Ask the sorter itself how long a move takes under its configured speed profile, from the current bin by default
+  public predictMoveTime(sorter: number, toBin: number, fromBin?: number): Promise<number> {
+    const deviceName = DeviceName[`SORTER_${sorter}` as keyof typeof DeviceName];
+    const bins = fromBin !== undefined ? `${fromBin},${toBin}` : `${toBin}`;
+    this.deviceManager.sendCommand(deviceName, `${ArduinoCommands.PREDICT_MOVE}${bins}`);
+    return new Promise<number>((resolve, reject) => {
+      const pending = this.pendingPredictions[sorter] ?? [];
+      this.pendingPredictions[sorter] = pending;
+      const entry: PendingPrediction = {
+        resolve,
+        reject,
+        timeout: setTimeout(() => {
+          pending.splice(pending.indexOf(entry), 1);
+          reject(new Error(`Sorter ${sorter} did not answer the move prediction`));
+        }, MOVE_PREDICTION_TIMEOUT_MS),
+      };
+      pending.push(entry);
+    });
+  }
+
+  private handleMovePrediction = (deviceName: DeviceName, fromBin: number, toBin: number, durationMs: number): void => {
+    const sorter = Number(/^sorter_(\d+)$/.exec(deviceName)?.[1] ?? NaN);
+    const entry = this.pendingPredictions[sorter]?.shift();
+    if (!entry) return;
+    clearTimeout(entry.timeout);
+    entry.resolve(durationMs);
+  };
+
+  // Rearrange every sorter's bins from the parts seen so far and store the layouts in a single settings update,
+  // which sends them to the sorters. Logical bin numbers, and so the bin lookup, stay the same.
+  public async optimizeBinLayouts(): Promise<void> {
+    const settings = this.settingsManager.getSettings();
+    if (!settings) {
+      throw new Error('Settings not available');
+    }
+    let optimized = false;
+    const sorters = settings.sorters.map((sorterSettings, sorter) => {
+      const binLayout = this.optimizeSorterBinLayout(sorter, sorterSettings);
+      if (!binLayout) return sorterSettings;
+      optimized = true;
+      return { ...sorterSettings, binLayout };
+    });
+    if (optimized) {
+      await this.settingsManager.updateSettings({ sorters });
+    }
+  }
+
+  // Returns null if the sorter hasn't seen enough parts yet
+  private optimizeSorterBinLayout(sorter: number, sorterSettings: SorterSettingsType): number[] | null {
+    const visits = this.binVisits[sorter];
+    const model = this.travelModels[sorter];
+    if (!visits || !model) return null;
+    const partCount = visits.reduce((sum, count) => sum + count, 0);
+    if (partCount < MIN_PARTS_FOR_BIN_LAYOUT) {
+      console.warn(
+        `\x1b[33mSorter ${sorter}: only ${partCount} parts seen, need ${MIN_PARTS_FOR_BIN_LAYOUT} to optimize the bin layout.\x1b[0m`,
+      );
+      return null;
+    }
+
+    const binLayout = optimizeBinLayout({
+      gridDimension: sorterSettings.gridDimension,
+      rowMajorOrder: sorterSettings.rowMajorOrder,
+      visits,
+      transitions: this.binTransitions[sorter],
+      travelTime: (dx, dy) => model.predict(dx, dy),
+    });
+    console.log(`\x1b[32mSorter ${sorter}: bin layout optimized from ${partCount} parts.\x1b[0m`);
+    return binLayout;
+  }
+
+  public scheduleSorterMove(sorter: number, bin: number, moveTime: number, part?: Part): NodeJS.Timeout {
+    const deviceName = DeviceName[`SORTER_${sorter}` as keyof typeof DeviceName];
+    const clock = this.deviceManager.getDeviceClock(deviceName);
+    if (!part || !clock?.isSynced()) {
+      // No device timebase yet, start the move from a host timer
+      const delay = moveTime - Date.now();
+      return setTimeout(() => {
+        if (part) this.recordPartBin(part);
+        this.moveSorter(sorter, bin);
+      }, delay);
+    }
+
+    const sendDelay = moveTime - MOVE_QUEUE_LEAD_MS - Date.now();
     return setTimeout(() => {
-      this.moveSorter(sorter, bin);
-    }, delay);
+      const moveId = this.nextMoveIds[sorter] ?? 1;
+      this.nextMoveIds[sorter] = (moveId % 65535) + 1;
+      const notBeforeUs = clock.hostToDeviceMicros(moveTime);
+      this.deviceManager.sendCommand(deviceName, `${ArduinoCommands.QUEUE_MOVE}${moveId},${bin},${notBeforeUs}`);
+      part.moveId = moveId;
+      this.recordPartBin(part);
+      this.currentPositions[sorter] = bin;
+      this.socketManager.emitSorterPositionUpdate(sorter, bin);
+    }, sendDelay);
+  }
+
+  public cancelQueuedMove(sorter: number, moveId: number): void {
+    const deviceName = DeviceName[`SORTER_${sorter}` as keyof typeof DeviceName];
+    this.deviceManager.sendCommand(deviceName, ArduinoCommands.CANCEL_QUEUED_MOVE, moveId);
   }
 
   public getCurrentPosition(sorter: number): number {
@@ -0,0 +1,212 @@
+import { SorterSettingsType } from '../../types/settings.type';
+
+export interface AxisProfile {
+  maxSpeed: number; // bins per ms
+  acceleration: number; // bins per ms²
+}
+
+interface TravelSample {
+  dx: number; // bins travelled on the X axis
+  dy: number; // bins travelled on the Y axis
+  durationMs: number;
+  axisMs?: { x: number; y: number }; // time each axis took, only when the axes move independently
+}
+
+/**
+ * Predicts sorter move times from per-axis trapezoidal speed profiles.
+ *
+ * Both axes start together, so a move takes as long as its slower axis plus a fixed overhead. The profiles start
+ * from the sorter settings (steps per bin, per-axis speed and acceleration) and are refined by a damped least squares
+ * fit over the move durations the sorter reports as 'MT:<from>,<to>,<us>,<x us>,<y us>' (or a 'D' frame in binary
+ * mode). When the axes move independently, each axis is fitted to its own time. Parameters a window of moves cannot
+ * distinguish are held at the settings-derived values.
+ */
+export class SorterTravelModel {
+  private static readonly MAX_SAMPLES = 64;
+  private static readonly MIN_SAMPLES_FOR_FIT = 8;
+  private static readonly FIT_ITERATIONS = 10;
+  private static readonly PRIOR_WEIGHT_MS = 20; // cost in ms of moving a profile parameter e-fold from its prior
+  private static readonly OVERHEAD_WEIGHT = 0.1; // keeps the overhead defined when every move is the same
+  private static readonly MAX_DURATION_MS = 10000; // longer reports come from stalls or interrupted moves
+
+  private readonly prior: number[];
+  private params: number[]; // [ln vx, ln ax, ln vy, ln ay, overhead ms]
+  private samples: TravelSample[] = [];
+  private fitted = false;
+
+  // independentAxes: each axis runs at its own limits, so the time it took to stop measures its profile
+  constructor(x: AxisProfile, y: AxisProfile, private readonly independentAxes: boolean = true) {
+    this.prior = [Math.log(x.maxSpeed), Math.log(x.acceleration), Math.log(y.maxSpeed), Math.log(y.acceleration), 0];
+    this.params = [...this.prior];
+  }
+
+  public static fromSettings(sorter: SorterSettingsType): SorterTravelModel {
+    const steps = (stepsToLast: number, offset: number) =>
+      sorter.gridDimension > 1 ? Math.max((stepsToLast - offset) / (sorter.gridDimension - 1), 1) : 1;
+    // speed is the step interval in us, acceleration is in steps/s²
+    const profile = (stepsPerBin: number, speed: number, acceleration: number): AxisProfile => ({
+      maxSpeed: 1000 / (Math.max(speed, 1) * stepsPerBin),
+      acceleration: Math.max(acceleration, 1) / 1e6 / stepsPerBin,
+    });
+    // In synchronized mode the faster axis is slowed down to the slower one, which does not change the move time
+    return new SorterTravelModel(
+      profile(steps(sorter.xStepsToLast, sorter.xOffset), sorter.speed, sorter.acceleration),
+      profile(
+        steps(sorter.yStepsToLast, sorter.yOffset),
+        sorter.ySpeed || sorter.speed,
+        sorter.yAcceleration || sorter.acceleration,
+      ),
+      !sorter.synchronizedMoves,
+    );
+  }
+
+  public isFitted(): boolean {
+    return this.fitted;
+  }
+
+  public addSample(dx: number, dy: number, durationMs: number, axisMs?: { x: number; y: number }): void {
+    if ((dx === 0 && dy === 0) || !(durationMs > 0) || durationMs > SorterTravelModel.MAX_DURATION_MS) return;
+
+    this.samples.push({
+      dx: Math.abs(dx),
+      dy: Math.abs(dy),
+      durationMs,
+      axisMs: this.independentAxes ? axisMs : undefined,
+    });
+    if (this.samples.length > SorterTravelModel.MAX_SAMPLES) {
+      this.samples.shift();
+    }
+    if (this.samples.length >= SorterTravelModel.MIN_SAMPLES_FOR_FIT) {
+      this.refit();
+      this.fitted = true;
+    }
+  }
+
+  public predict(dx: number, dy: number): number {
+    if (dx === 0 && dy === 0) return 0;
+    return SorterTravelModel.moveTime(this.params, Math.abs(dx), Math.abs(dy));
+  }
+
+  public getProfiles(): { x: AxisProfile; y: AxisProfile; overheadMs: number } {
+    const [lnVx, lnAx, lnVy, lnAy, overheadMs] = this.params;
+    return {
+      x: { maxSpeed: Math.exp(lnVx), acceleration: Math.exp(lnAx) },
+      y: { maxSpeed: Math.exp(lnVy), acceleration: Math.exp(lnAy) },
+      overheadMs,
+    };
+  }
+
+  private static moveTime(params: number[], dx: number, dy: number): number {
+    const [lnVx, lnAx, lnVy, lnAy, overheadMs] = params;
+    const tx = SorterTravelModel.axisTime(dx, Math.exp(lnVx), Math.exp(lnAx));
+    const ty = SorterTravelModel.axisTime(dy, Math.exp(lnVy), Math.exp(lnAy));
+    return Math.max(tx, ty) + overheadMs;
+  }
+
+  // Residuals of one recorded move: per moving axis if the axis times are known, else of the whole move
+  private static sampleResiduals(params: number[], sample: TravelSample): number[] {
+    const [lnVx, lnAx, lnVy, lnAy, overheadMs] = params;
+    if (!sample.axisMs) {
+      return [SorterTravelModel.moveTime(params, sample.dx, sample.dy) - sample.durationMs];
+    }
+    const residuals: number[] = [];
+    if (sample.dx > 0) {
+      residuals.push(
+        SorterTravelModel.axisTime(sample.dx, Math.exp(lnVx), Math.exp(lnAx)) + overheadMs - sample.axisMs.x,
+      );
+    }
+    if (sample.dy > 0) {
+      residuals.push(
+        SorterTravelModel.axisTime(sample.dy, Math.exp(lnVy), Math.exp(lnAy)) + overheadMs - sample.axisMs.y,
+      );
+    }
+    return residuals;
+  }
+
+  // Trapezoidal profile: accelerate, cruise, decelerate. Short moves never reach full speed (triangular profile).
+  private static axisTime(distance: number, maxSpeed: number, acceleration: number): number {
+    if (distance <= 0) return 0;
+    if (distance >= (maxSpeed * maxSpeed) / acceleration) {
+      return distance / maxSpeed + maxSpeed / acceleration;
+    }
+    return 2 * Math.sqrt(distance / acceleration);
+  }
+
+  // Residuals of the measured durations plus the pull towards the settings-derived prior
+  private residuals(params: number[]): number[] {
+    const residuals = this.samples.flatMap((s) => SorterTravelModel.sampleResiduals(params, s));
+    for (let i = 0; i < 4; i++) {
+      residuals.push(SorterTravelModel.PRIOR_WEIGHT_MS * (params[i] - this.prior[i]));
+    }
+    residuals.push(SorterTravelModel.OVERHEAD_WEIGHT * params[4]);
+    return residuals;
+  }
+
+  // Levenberg-Marquardt with a forward difference Jacobian, started from the current fit
+  private refit(): void {
+    const steps = [1e-4, 1e-4, 1e-4, 1e-4, 0.01];
+    const cost = (r: number[]) => r.reduce((sum, value) => sum + value * value, 0);
+    let params = [...this.params];
+    let residuals = this.residuals(params);
+    let lambda = 1e-3;
+
+    for (let iteration = 0; iteration < SorterTravelModel.FIT_ITERATIONS; iteration++) {
+      const jacobian = steps.map((step, k) => {
+        const shifted = [...params];
+        shifted[k] += step;
+        return this.residuals(shifted).map((value, i) => (value - residuals[i]) / step);
+      });
+
+      // Normal equations: (JᵀJ + λ·diag(JᵀJ)) δ = -Jᵀr
+      const jtj = jacobian.map((a) => jacobian.map((b) => a.reduce((sum, value, i) => sum + value * b[i], 0)));
+      const jtr = jacobian.map((a) => a.reduce((sum, value, i) => sum + value * residuals[i], 0));
+
+      let improved = false;
+      while (lambda < 1e6) {
+        const system = jtj.map((row, i) => row.map((value, j) => (i === j ? value * (1 + lambda) : value)));
+        const delta = SorterTravelModel.solve(system, jtr.map((value) => -value));
+        if (!delta) break;
+        const candidate = params.map((value, k) => value + delta[k]);
+        const candidateResiduals = this.residuals(candidate);
+        if (cost(candidateResiduals) < cost(residuals)) {
+          params = candidate;
+          residuals = candidateResiduals;
+          lambda = Math.max(lambda / 3, 1e-6);
+          improved = true;
+          break;
+        }
+        lambda *= 3;
+      }
+      if (!improved) break;
+    }
+
+    if (params.every(Number.isFinite)) {
+      this.params = params;
+    }
+  }
+
+  // Gaussian elimination with partial pivoting, null if the system is singular
+  private static solve(matrix: number[][], vector: number[]): number[] | null {
+    const n = vector.length;
+    const a = matrix.map((row, i) => [...row, vector[i]]);
+    for (let col = 0; col < n; col++) {
+      let pivot = col;
+      for (let row = col + 1; row < n; row++) {
+        if (Math.abs(a[row][col]) > Math.abs(a[pivot][col])) pivot = row;
+      }
+      if (Math.abs(a[pivot][col]) < 1e-12) return null;
+      [a[col], a[pivot]] = [a[pivot], a[col]];
+      for (let row = col + 1; row < n; row++) {
+        const factor = a[row][col] / a[col][col];
+        for (let k = col; k <= n; k++) a[row][k] -= factor * a[col][k];
+      }
+    }
+    const x = new Array(n).fill(0);
+    for (let row = n - 1; row >= 0; row--) {
+      let sum = a[row][n];
+      for (let k = row + 1; k < n; k++) sum -= a[row][k] * x[k];
+      x[row] = sum / a[row][row];
+    }
+    return x;
+  }
+}
@@ -21,6 +21,13 @@ export class SpeedManager extends BaseComponent {
   // Current speed in pixels per millisecond
   private currentSpeed: number = 0;
 
+  // Part flow at the feeder sensor, summarized every FEEDER_STATS_PARTS parts
+  private readonly FEEDER_STATS_PARTS = 50;
+  private feederStatsStartMs: number | null = null;
+  private feederStatsParts = 0;
+  private feederDwellTotalMs = 0;
+  private feederDwellMaxMs = 0;
+
   constructor(config: SpeedManagerConfig) {
     super('SpeedManager');
     this.deviceManager = config.deviceManager;
@@ -44,6 +51,7 @@ export class SpeedManager extends BaseComponent {
 
       // Register for settings updates
       this.settingsManager.registerSettingsUpdateCallback(this.reinitialize.bind(this));
+      this.deviceManager.registerFeederPartCallback(this.handleFeederPart);
 
       this.setStatus(ComponentStatus.READY);
     } catch (error) {
@@ -59,6 +67,11 @@ export class SpeedManager extends BaseComponent {
   public async deinitialize(): Promise<void> {
     // Unregister settings callback
     this.settingsManager.unregisterSettingsUpdateCallback(this.reinitialize.bind(this));
+    this.deviceManager.unregisterFeederPartCallback(this.handleFeederPart);
+    this.feederStatsStartMs = null;
+    this.feederStatsParts = 0;
+    this.feederDwellTotalMs = 0;
+    this.feederDwellMaxMs = 0;
     this.defaultSpeed = 0;
     this.currentSpeed = 0;
     this.setStatus(ComponentStatus.UNINITIALIZED);
@@ -137,11 +150,39 @@ export class SpeedManager extends BaseComponent {
 
       // Calculate and update hopper feeder pause time based on conveyor speed
       const speedRatio = settings.conveyorSpeed / speed;
-      const newPauseTime = Math.round(settings.feederPauseTime * speedRatio);
-      this.deviceManager.updateFeederPauseTime(newPauseTime);
+      if (settings.feederTargetPartsPerMinute > 0) {
+        // The feeder sets its own pause time in target rate mode, scale the rate instead
+        this.deviceManager.updateFeederTargetRate(Math.max(settings.feederTargetPartsPerMinute / speedRatio, 1));
+      } else {
+        const newPauseTime = Math.round(settings.feederPauseTime * speedRatio);
+        this.deviceManager.updateFeederPauseTime(newPauseTime);
+      }
     }, atTime - Date.now());
   }
 
+  private handleFeederPart = (event: 'arrived' | 'left', hostMs: number, dwellMs?: number): void => {
+    if (event === 'left') {
+      this.feederDwellTotalMs += dwellMs ?? 0;
+      this.feederDwellMaxMs = Math.max(this.feederDwellMaxMs, dwellMs ?? 0);
+      return;
+    }
+
+    if (this.feederStatsStartMs === null) {
+      this.feederStatsStartMs = hostMs;
+    } else if (++this.feederStatsParts >= this.FEEDER_STATS_PARTS) {
+      const partsPerMinute = (this.feederStatsParts * 60000) / Math.max(hostMs - this.feederStatsStartMs, 1);
+      const averageDwellMs = Math.round(this.feederDwellTotalMs / this.feederStatsParts);
+      console.log(
+        `\x1b[32mFeeder: ${partsPerMinute.toFixed(1)} parts/min, dwell at the sensor ${averageDwellMs} ms average, ` +
+          `${this.feederDwellMaxMs} ms max\x1b[0m`,
+      );
+      this.feederStatsStartMs = hostMs;
+      this.feederStatsParts = 0;
+      this.feederDwellTotalMs = 0;
+      this.feederDwellMaxMs = 0;
+    }
+  };
+
   protected notifyStatusChange(): void {
     this.socketManager.emitComponentStatusUpdate(this.getName(), this.getStatus(), this.getError());
   }
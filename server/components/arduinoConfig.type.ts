@@ -17,6 +17,11 @@ export type SorterInitConfig = {
   HOMING_SPEED: number;
   SPEED: number;
   ROW_MAJOR_ORDER: boolean;
+  HOMING_FAST_SPEED: number;
+  Y_ACCELERATION: number;
+  Y_SPEED: number;
+  SYNCHRONIZED_MOVES: boolean;
+  S_CURVE_STEPS: number;
 };
 
 export type ConveyorJetsInitConfig = {
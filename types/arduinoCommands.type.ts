@@ -10,13 +10,40 @@ export const ArduinoCommands = {
   CONVEYOR_ON_OFF: 'o', // data: null
   CONVEYOR_SPEED: 'c', // data: speed (0-255)
   FIRE_JET: 'j', // data: jet number
+  FIRE_JET_AT: 'J', // data: '<jet number>,<device micros fire time>'
+  SET_JET_PULSE: 'w', // data: '<jet>,<pulse us>'
+  CANCEL_JET_AT: 'X', // data: '<jet number>,<device micros fire time>'
+  FIRE_JET_AT_POSITION: 'K', // data: '<jet number>,<encoder position>'
+  CANCEL_JET_AT_POSITION: 'k', // data: '<jet number>,<encoder position>'
+  AUTOTUNE: 'A', // data: 1 = start, 0 = abort
+  FEEDFORWARD_TABLE: 'F', // data: '<pwm at 0 rpm>,...,<pwm at max rpm>' (6 values)
+  ODOMETRY_INTERVAL: 'e', // data: sample interval in ms, 0 = off
+  // clock sync (all devices)
+  TIME_SYNC: 't', // data: sequence number
+  PROTOCOL_MODE: 'P', // data: 1 = binary frames, 0 = legacy ASCII
+  BAUD_RATE: 'U', // data: requested baud rate
+  CONFIRM_BAUD_RATE: 'u',
+  LOG_LEVEL: 'L', // data: '<subsystem>,<level>', subsystem 255 = all
   // sorter commands
   CENTER_SORTER: 'h', // data: null
   MOVE_TO_ORIGIN: 'a', // data: null
   MOVE_TO_BIN: 'm', // data: bin number
+  QUEUE_MOVE: 'Q', // data: '<move id>,<bin number>,<device micros not before>'
+  CANCEL_QUEUED_MOVE: 'x', // data: move id
+  PREDICT_MOVE: 'd', // data: '<to bin>' or '<from bin>,<to bin>'
+  BIN_MAP: 'B', // data: '<start bin>,<physical bin>,...'
+  COMMIT_BIN_MAP: 'N', // data: 1 = apply and store, 0 = clear
+  PARK: 'i', // data: '<idle delay ms>,<park bin>', bin 0 = off
+  VERIFY_POSITION: 'V', // data: '<every n moves>,<idle delay ms>', n 0 = off
   // hopper & feeder commands
   HOPPER_ON_OFF: 'b', // data: null
   FEEDER_ON_OFF: 'f', // data: null
+  FEEDER_TARGET_RATE: 'R', // data: parts per minute, 0 = fixed speed and pause time
+  DISTANCE_SENSOR_SETUP: 'S', // data: '<sensor>,<i2c address>[,<min interval ms>,<max interval ms>]', address 0 = none
+  DISTANCE_SENSOR_HEALTH: 'H', // data: null
+  HOPPER_POLICY: 'C', // data: '<policy>,<threshold>,<min cycle interval ms>', policy index in hopperCyclePolicies
+  // data: '<stroke>,<down us/step>,<down accel>,<up us/step>,<up accel>,<dwell ms>,<loaded stroke>', 0 = full stroke
+  HOPPER_PROFILE: 'M',
 } as const;
 
 // Creating a union of literals from arduinoCommands values
@@ -26,11 +53,36 @@ const arduinoCommandUnion = z.union([
   z.literal(ArduinoCommands.CONVEYOR_ON_OFF),
   z.literal(ArduinoCommands.CONVEYOR_SPEED),
   z.literal(ArduinoCommands.FIRE_JET),
+  z.literal(ArduinoCommands.FIRE_JET_AT),
+  z.literal(ArduinoCommands.SET_JET_PULSE),
+  z.literal(ArduinoCommands.CANCEL_JET_AT),
+  z.literal(ArduinoCommands.FIRE_JET_AT_POSITION),
+  z.literal(ArduinoCommands.CANCEL_JET_AT_POSITION),
+  z.literal(ArduinoCommands.AUTOTUNE),
+  z.literal(ArduinoCommands.FEEDFORWARD_TABLE),
+  z.literal(ArduinoCommands.ODOMETRY_INTERVAL),
+  z.literal(ArduinoCommands.TIME_SYNC),
+  z.literal(ArduinoCommands.PROTOCOL_MODE),
+  z.literal(ArduinoCommands.BAUD_RATE),
+  z.literal(ArduinoCommands.CONFIRM_BAUD_RATE),
+  z.literal(ArduinoCommands.LOG_LEVEL),
   z.literal(ArduinoCommands.CENTER_SORTER),
   z.literal(ArduinoCommands.MOVE_TO_ORIGIN),
   z.literal(ArduinoCommands.MOVE_TO_BIN),
+  z.literal(ArduinoCommands.QUEUE_MOVE),
+  z.literal(ArduinoCommands.CANCEL_QUEUED_MOVE),
+  z.literal(ArduinoCommands.PREDICT_MOVE),
+  z.literal(ArduinoCommands.BIN_MAP),
+  z.literal(ArduinoCommands.COMMIT_BIN_MAP),
+  z.literal(ArduinoCommands.PARK),
+  z.literal(ArduinoCommands.VERIFY_POSITION),
   z.literal(ArduinoCommands.HOPPER_ON_OFF),
   z.literal(ArduinoCommands.FEEDER_ON_OFF),
+  z.literal(ArduinoCommands.FEEDER_TARGET_RATE),
+  z.literal(ArduinoCommands.DISTANCE_SENSOR_SETUP),
+  z.literal(ArduinoCommands.DISTANCE_SENSOR_HEALTH),
+  z.literal(ArduinoCommands.HOPPER_POLICY),
+  z.literal(ArduinoCommands.HOPPER_PROFILE),
 ]);
 
 // Define the schema for ArduinoDeviceCommand
@@ -6,8 +6,12 @@ export interface Part {
   initialTime: number;
   jetTime: number;
   jetRef?: NodeJS.Timeout;
+  jetFireAtUs?: number; // device micros() of a timestamped jet fire already sent to the conveyor
+  jetFireAtPosition?: number; // encoder position of a position-triggered jet fire already sent to the conveyor
   moveTime: number;
   moveRef?: NodeJS.Timeout;
+  moveId?: number; // id of a move already queued on the sorter
+  binRecorded?: boolean; // counted in the sorter's bin statistics, which a rescheduled move must not repeat
   moveFinishedTime: number;
   defaultArrivalTime: number; // the time it takes for the part to reach the jet at default speed
   arrivalTimeDelay: number;
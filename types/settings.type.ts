@@ -3,6 +3,10 @@
 import { z } from 'zod';
 import { serialPortNameEnumSchema } from './serialPort.type';
 
+// What starts a hopper cycle, in the order of HopperPolicy in hopper_feeder.cpp:
+// feeder vibration time, no part at the feeder exit for a while, or a low fill level reading
+export const hopperCyclePolicies = ['vibrationTime', 'starvation', 'fillLevel'] as const;
+
 export const sorterSettingsSchema = z.object({
   name: serialPortNameEnumSchema.default(serialPortNameEnumSchema.Values.conveyor_jets),
   serialPort: z.string().min(1).default('default'),
@@ -29,8 +33,16 @@ export const sorterSettingsSchema = z.object({
   yStepsToLast: z.coerce.number().default(6100),
   acceleration: z.coerce.number().min(0).default(5000),
   homingSpeed: z.coerce.number().min(0).default(1000),
+  homingFastSpeed: z.coerce.number().min(0).default(0), // step interval in us of the first endstop approach, 0 = off
   speed: z.coerce.number().min(0).default(120),
+  // acceleration and speed are the X axis limits, 0 = Y uses the same
+  yAcceleration: z.coerce.number().min(0).default(0),
+  ySpeed: z.coerce.number().min(0).default(0),
+  synchronizedMoves: z.boolean().default(false), // both axes finish each move together
+  sCurveSteps: z.coerce.number().int().min(0).default(0), // steps of jerk-limited acceleration ramp, 0 = trapezoidal
   rowMajorOrder: z.boolean().default(true),
+  // Physical bin of each logical bin (index 0 = bin 1), empty = bins follow rowMajorOrder
+  binLayout: z.array(z.coerce.number().int().min(1)).default([]),
 });
 
 export type SorterSettingsType = z.infer<typeof sorterSettingsSchema>;
@@ -52,6 +64,14 @@ export const settingsSchema = z.object({
     .default(1),
   conveyorJetsSerialPort: z.string().default(''),
   hopperFeederSerialPort: z.string().default(''),
+  binarySerialProtocol: z.boolean().default(false),
+  firmwareDebugLogging: z.boolean().default(false),
+  maxSerialBaudRate: z.coerce
+    .number()
+    .refine((value) => [9600, 115200, 250000, 500000].includes(value), {
+      message: 'Baud rate must be 9600, 115200, 250000 or 500000',
+    })
+    .default(115200),
   classificationThresholdPercentage: z.coerce
     .number()
     .min(0, { message: 'Classification threshold must be between 0 and 2' })
@@ -66,12 +86,47 @@ export const settingsSchema = z.object({
   feederPauseTime: z.coerce.number().min(0).default(1000),
   feederShortMoveTime: z.coerce.number().min(0).default(250),
   feederLongMoveTime: z.coerce.number().min(0).default(2000),
+  // The feeder tunes its speed and pause time to deliver this many parts per minute (0 = fixed speed and pause time)
+  feederTargetPartsPerMinute: z.coerce.number().int().min(0).max(600).default(0),
+  // I2C address of an optional distance sensor measuring the hopper fill level (0 = not fitted)
+  hopperFillSensorAddress: z.coerce.number().int().min(0).max(127).default(0),
   conveyorPulsesPerRevolution: z.coerce.number().min(0).default(20),
   conveyorKp: z.coerce.number().min(0).default(2.0),
   conveyorKi: z.coerce.number().min(0).default(5.0),
   conveyorKd: z.coerce.number().min(0).default(1.0),
+  conveyorRampRPMPerSecond: z.coerce.number().int().min(0).default(200),
+  // RPM -> PWM feedforward at 0, 20, ... 100% of maxConveyorRPM, measured by the conveyor autotune. Empty = firmware default.
+  conveyorFeedforwardPwm: z.array(z.coerce.number().int().min(0).max(255)).default([]),
+  conveyorOdometryIntervalMs: z.coerce
+    .number()
+    .int()
+    .min(0, { message: 'Odometry interval must be 0 (off) or at least 10 ms' })
+    .refine((value) => value === 0 || value >= 10, { message: 'Odometry interval must be 0 (off) or at least 10 ms' })
+    .max(65535)
+    .default(100),
+  positionTriggeredJets: z.boolean().default(false),
+  // Idle sorters move to the bin closest to where the next part is likely to go after this long (0 = off)
+  sorterParkDelayMs: z.coerce.number().int().min(0).max(60000).default(3000),
+  // Idle sorters re-approach their endstops and correct lost steps after this many moves (0 = off)
+  sorterVerifyEveryMoves: z.coerce.number().int().min(0).max(65535).default(0),
   sorters: z.array(sorterSettingsSchema).default([]),
   hopperCycleInterval: z.coerce.number().min(0).default(20000),
+  hopperCyclePolicy: z.enum(hopperCyclePolicies).default('vibrationTime'),
+  // 'starvation': ms without a part at the feeder exit before the hopper cycles
+  hopperStarvationMs: z.coerce.number().int().min(0).default(5000),
+  // 'fillLevel': fill sensor distance above which the hopper cycles (the parts are farther away when it runs low)
+  hopperFillThreshold: z.coerce.number().int().min(0).max(65535).default(150),
+  // 'starvation' and 'fillLevel': ms after a cycle before the next one, while the released parts reach the sensors
+  hopperMinCycleIntervalMs: z.coerce.number().int().min(0).default(3000),
+  // Hopper stroke profile, speeds in us/step and accelerations in steps/s²
+  hopperStrokeSteps: z.coerce.number().int().min(1).default(2020),
+  // Shorter stroke for cycles that start while a part still waits at the feeder exit (0 = full stroke)
+  hopperLoadedStrokeSteps: z.coerce.number().int().min(0).default(0),
+  hopperDownSpeedUs: z.coerce.number().int().min(1).default(1000),
+  hopperDownAcceleration: z.coerce.number().int().min(1).default(1000),
+  hopperUpSpeedUs: z.coerce.number().int().min(1).default(1000),
+  hopperUpAcceleration: z.coerce.number().int().min(1).default(1000),
+  hopperBottomDwellMs: z.coerce.number().int().min(0).default(10),
 });
 
 export type SettingsType = z.infer<typeof settingsSchema>;
@@ -12,6 +12,8 @@ export enum FrontToBackEvents {
   LIST_SERIAL_PORTS = 'list-serial-ports',
   RESET_SORT_PROCESS = 'reset-sort-process',
   UPDATE_FEEDER_SETTINGS = 'update-feeder-settings',
+  AUTOTUNE_CONVEYOR = 'autotune-conveyor',
+  OPTIMIZE_BIN_LAYOUT = 'optimize-bin-layout',
 }
 
 export enum BackToFrontEvents {
@@ -40,6 +42,8 @@ export interface EventPayloads {
   [FrontToBackEvents.FIRE_JET]: { sorter: number };
   [FrontToBackEvents.LIST_SERIAL_PORTS]: void;
   [FrontToBackEvents.RESET_SORT_PROCESS]: void;
+  [FrontToBackEvents.AUTOTUNE_CONVEYOR]: void;
+  [FrontToBackEvents.OPTIMIZE_BIN_LAYOUT]: void;
   [FrontToBackEvents.UPDATE_FEEDER_SETTINGS]: {
     vibrationSpeed: number;
     stopDelay: number;